@@ -1,641 +1,810 @@
+#include "frame.h"
+#include "game.h"
+#include "input.h"
+#include "profiler.h"
 #include "raylib.h"
 #include "raymath.h"
+#include "replay.h"
+#include "rlgl.h"
+#include "snapshot.h"
 
 #include <math.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 // CONSTANTS
-#define WIDTH 800
-#define HEIGHT 600
+#define PARTICLE_SPRITE_SIZE 64
+#define PARTICLE_DRAW_CHUNK 1024
+#define POLYGON_DRAW_CHUNK 1024
+#define MAX_FRAME_TIME 0.25f
 
-#define MAX_ASTEROIDS 64
-#define NUM_START_ASTEROIDS 6
+#define HEADLESS_DEFAULT_TICKS 10000
+#define QUICKSAVE_PATH "quicksave.snap"
 
-#define R_BIG 55.0f
-#define R_MED 35.0f
-#define R_SMALL 18.0f
-
-#define SCALE 0.8f
-#define VEL 2.0f
-#define BULLET_SPEED 5.0f
-#define NUM_BULLETS 10
-
-#define MAX_STARS 100
-#define MAX_PARTICLES 200
-
-// TYPES
-typedef enum {
-    AST_SMALL,
-    AST_MED,
-    AST_BIG,
-} AsteroidSize;
-
-typedef struct {
-    Vector2 pos;
-    int sides;
-    float radius, rotation;
-    Vector2 vel;
-    float mass;
-
-    int active;
-    int hits;
-    int maxHits;
-    AsteroidSize size;
-} Asteroid;
-
-typedef struct {
-    Vector2 pos;
-    float radius;
-    Vector2 vel;
-} Spaceship;
-
-typedef struct {
-    Vector2 pos;
-    float radius;
-    Vector2 vel;
-} Bullet;
-
-typedef struct {
-    Vector2 pos;
-    float brightness;
-    float phase;
-} Star;
-
-typedef struct {
-    Vector2 pos;
-    Vector2 vel;
-    float lifetime;
-    float maxLifetime;
-    Color color;
-    float size;
-} Particle;
-
-// GAME STATE / GLOBAL STATE
-Asteroid ASTEROIDS[MAX_ASTEROIDS];
-Bullet BULLETS[NUM_BULLETS];
-int bulletActive[NUM_BULLETS];
-Star STARS[MAX_STARS];
-Particle PARTICLES[MAX_PARTICLES];
+// FRONTEND STATE
+Texture2D particleSprite;
+// unitPolygons[n] holds the n vertices of a unit n-gon plus the first again.
+Vector2 unitPolygons[ASTEROID_MAX_SIDES + 1][ASTEROID_MAX_SIDES + 1];
+int showProfiler = 0;
 
 // STARS
-void initStars() {
-    for (int i = 0; i < MAX_STARS; i++) {
-        STARS[i].pos = (Vector2){(float)GetRandomValue(0, WIDTH), (float)GetRandomValue(0, HEIGHT)};
-        STARS[i].brightness = (float)GetRandomValue(50, 150) / 255.0f;
-        STARS[i].phase = (float)GetRandomValue(0, 360);
-    }
-}
-
-void drawStars() {
-    for (int i = 0; i < MAX_STARS; i++) {
-        STARS[i].phase += 0.02f;
-        float twinkle = 0.7f + 0.3f * sinf(STARS[i].phase);
-        float alpha = STARS[i].brightness * twinkle;
+void drawStars(const RenderFrame *f) {
+    for (int i = 0; i < f->starCount; i++) {
+        float twinkle = 0.7f + 0.3f * sinf(f->stars[i].phase);
+        float alpha = f->stars[i].brightness * twinkle;
 
         Color starColor = (Color){200, 200, 255, (alpha * 255)};
-        DrawPixel(STARS[i].pos.x, STARS[i].pos.y, starColor);
+        DrawPixel(f->stars[i].pos.x, f->stars[i].pos.y, starColor);
 
         if (i % 7 == 0) {
-            DrawPixel(STARS[i].pos.x + 1, STARS[i].pos.y, (Color){200, 200, 255, (alpha * 128)});
+            DrawPixel(f->stars[i].pos.x + 1, f->stars[i].pos.y,
+                      (Color){200, 200, 255, (alpha * 128)});
         }
     }
 }
 
 // PARTICLES
-void createParticle(Vector2 pos, Vector2 vel, Color color, float lifetime, float size) {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (PARTICLES[i].lifetime <= 0) {
-            PARTICLES[i].pos = pos;
-            PARTICLES[i].vel = vel;
-            PARTICLES[i].color = color;
-            PARTICLES[i].size = size;
-            PARTICLES[i].lifetime = lifetime;
-            PARTICLES[i].maxLifetime = lifetime;
-            return;
+// An anti-aliased white disc. Tinting and scaling it reproduces a filled
+// circle, so all particles can share one texture and one batch.
+void initParticleSprite() {
+    int n = PARTICLE_SPRITE_SIZE;
+    Color *pixels = malloc(sizeof(Color) * n * n);
+    float r = n * 0.5f - 1.0f;
+
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            float dx = x + 0.5f - n * 0.5f;
+            float dy = y + 0.5f - n * 0.5f;
+            float coverage = Clamp(r - sqrtf(dx * dx + dy * dy) + 0.5f, 0.0f, 1.0f);
+            pixels[y * n + x] = (Color){255, 255, 255, (unsigned char)(255 * coverage)};
         }
     }
-}
-
-void updateParticles() {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (PARTICLES[i].lifetime > 0) {
-            PARTICLES[i].pos.x += PARTICLES[i].vel.x;
-            PARTICLES[i].pos.y += PARTICLES[i].vel.y;
-            PARTICLES[i].lifetime -= GetFrameTime();
 
-            float lifeRatio = PARTICLES[i].lifetime / PARTICLES[i].maxLifetime;
-            PARTICLES[i].color.a = 255 * lifeRatio;
+    Image img = {pixels, n, n, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    particleSprite = LoadTextureFromImage(img);
+    SetTextureFilter(particleSprite, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(img);
+}
+
+void pushParticleQuad(Vector2 c, float r, Color color) {
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    rlTexCoord2f(0.0f, 0.0f);
+    rlVertex2f(c.x - r, c.y - r);
+    rlTexCoord2f(0.0f, 1.0f);
+    rlVertex2f(c.x - r, c.y + r);
+    rlTexCoord2f(1.0f, 1.0f);
+    rlVertex2f(c.x + r, c.y + r);
+    rlTexCoord2f(1.0f, 0.0f);
+    rlVertex2f(c.x + r, c.y - r);
+}
+
+// Every live particle becomes a halo quad and a core quad on the shared
+// sprite. Quads are submitted in chunks sized so rlgl only flushes between
+// chunks, so a normal frame is a single draw call.
+void drawParticles(const RenderFrame *f, float alpha) {
+    const ParticleFrame *ps = &f->particles;
+
+    for (int begin = 0; begin < ps->count; begin += PARTICLE_DRAW_CHUNK) {
+        int end = begin + PARTICLE_DRAW_CHUNK < ps->count ? begin + PARTICLE_DRAW_CHUNK : ps->count;
+        rlCheckRenderBatchLimit(8 * (end - begin));
+
+        rlSetTexture(particleSprite.id);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.0f, 0.0f, 1.0f);
+        for (int i = begin; i < end; i++) {
+            float lifeRatio = ps->fade[i];
+            float currentSize = ps->size[i] * lifeRatio;
+            Vector2 pos = {Lerp(ps->prevX[i], ps->posX[i], alpha),
+                           Lerp(ps->prevY[i], ps->posY[i], alpha)};
+            Color color = ps->color[i];
+
+            color.a = (unsigned char)(255 * 0.3f * lifeRatio);
+            pushParticleQuad(pos, currentSize * 1.5f, color);
+            color.a = (unsigned char)(255 * lifeRatio);
+            pushParticleQuad(pos, currentSize, color);
         }
+        rlEnd();
+        rlSetTexture(0);
     }
 }
 
-void drawParticles() {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (PARTICLES[i].lifetime > 0) {
-            float lifeRatio = PARTICLES[i].lifetime / PARTICLES[i].maxLifetime;
-            float currentSize = PARTICLES[i].size * lifeRatio;
-
-            DrawCircleV(PARTICLES[i].pos, currentSize * 1.5f,
-                        Fade(PARTICLES[i].color, 0.3f * lifeRatio));
-            DrawCircleV(PARTICLES[i].pos, currentSize, PARTICLES[i].color);
+// POLYGONS
+// Vertices sit where DrawPoly puts them, at multiples of 360 / n degrees.
+void initUnitPolygons() {
+    for (int n = ASTEROID_MIN_SIDES; n <= ASTEROID_MAX_SIDES; n++) {
+        for (int k = 0; k <= n; k++) {
+            float angle = 2.0f * PI * (float)k / (float)n;
+            unitPolygons[n][k] = (Vector2){cosf(angle), sinf(angle)};
         }
     }
 }
 
-// HELPERS
-Vector2 getRandV() {
-    float angle = (float)GetRandomValue(0, 369) * DEG2RAD;
-    return (Vector2){cosf(angle), sinf(angle)};
-}
-
-AsteroidSize getAsteroidSize(float r) {
-    if (r >= R_BIG)
-        return AST_BIG;
-    if (r >= R_MED)
-        return AST_MED;
-    return AST_SMALL;
-}
+// Emits the same triangle fan as DrawPoly, but rotates and scales the unit
+// table with one sinf/cosf per polygon instead of two per vertex. The caller
+// owns rlBegin(RL_TRIANGLES).
+void pushPolygon(Vector2 c, int sides, float radius, float rotation, Color color) {
+    const Vector2 *unit = unitPolygons[sides];
+    float cs = cosf(rotation * DEG2RAD) * radius;
+    float sn = sinf(rotation * DEG2RAD) * radius;
+    Vector2 v[ASTEROID_MAX_SIDES + 1];
+    for (int k = 0; k <= sides; k++) {
+        v[k].x = c.x + unit[k].x * cs - unit[k].y * sn;
+        v[k].y = c.y + unit[k].x * sn + unit[k].y * cs;
+    }
 
-int maxHitsFromSize(AsteroidSize s) {
-    switch (s) {
-    case AST_SMALL:
-        return 1;
-    case AST_MED:
-        return 2;
-    case AST_BIG:
-        return 3;
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    for (int k = 0; k < sides; k++) {
+        rlVertex2f(c.x, c.y);
+        rlVertex2f(v[k + 1].x, v[k + 1].y);
+        rlVertex2f(v[k].x, v[k].y);
     }
-    return 1;
 }
 
-int findFreeAsteroidIndex() {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        if (!ASTEROIDS[i].active) {
-            return i;
+// ASTEROIDS
+void pushAsteroids(const RenderFrame *f, float alpha) {
+    const AsteroidFrame *as = &f->asteroids;
+
+    for (int begin = 0; begin < as->count; begin += POLYGON_DRAW_CHUNK) {
+        int end = begin + POLYGON_DRAW_CHUNK < as->count ? begin + POLYGON_DRAW_CHUNK : as->count;
+        int vertices = 0;
+        for (int i = begin; i < end; i++)
+            vertices += 3 * as->sides[i];
+        rlCheckRenderBatchLimit(vertices);
+
+        rlBegin(RL_TRIANGLES);
+        for (int i = begin; i < end; i++) {
+            Vector2 pos = {Lerp(as->prevX[i], as->posX[i], alpha),
+                           Lerp(as->prevY[i], as->posY[i], alpha)};
+            float rotation = Lerp(as->prevRotation[i], as->rotation[i], alpha);
+            pushPolygon(pos, as->sides[i], as->radius[i], rotation, as->color[i]);
         }
+        rlEnd();
     }
-    return -1;
 }
 
-// ASTEROIDS
-void createAsteroid(int i, Vector2 pos, float r, Vector2 velDir) {
-    int sides = GetRandomValue(3, 8);
-    float rotation = (float)GetRandomValue(1, 5);
-
-    AsteroidSize s = getAsteroidSize(r);
-
-    ASTEROIDS[i].pos = pos;
-    ASTEROIDS[i].sides = sides;
-    ASTEROIDS[i].radius = r;
-    ASTEROIDS[i].rotation = rotation;
-    ASTEROIDS[i].vel = Vector2Normalize(velDir);
-    ASTEROIDS[i].mass = r * r;
+// SPACESHIP
+void pushSpaceShip(const Spaceship *s, float alpha) {
+    Vector2 pos = Vector2Lerp(s->prevPos, s->pos, alpha);
+    rlCheckRenderBatchLimit(3 * 3 * 3);
+    rlBegin(RL_TRIANGLES);
+    pushPolygon(pos, 3, s->radius * 1.1f, 120, (Color){100, 180, 255, 255});
+    pushPolygon(pos, 3, s->radius, 120, (Color){150, 200, 255, 255});
+    pushPolygon(pos, 3, s->radius * 0.6f, 120, (Color){200, 230, 255, 255});
+    rlEnd();
+}
 
-    ASTEROIDS[i].active = 1;
-    ASTEROIDS[i].hits = 0;
-    ASTEROIDS[i].size = s;
-    ASTEROIDS[i].maxHits = maxHitsFromSize(s);
+// Asteroids and the ship go into rlgl's batch back to back as plain
+// triangles, so together they normally cost one draw call.
+void drawPolygons(const RenderFrame *f, float alpha) {
+    pushAsteroids(f, alpha);
+    pushSpaceShip(&f->ship, alpha);
 }
 
-void initAsteroids() {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        ASTEROIDS[i].active = 0;
+// BULLETS
+void drawBullets(const RenderFrame *f, float alpha) {
+    for (int i = 0; i < f->bulletCount; i++) {
+        const Bullet *b = &f->bullets[i];
+        DrawCircleV(Vector2Lerp(b->prevPos, b->pos, alpha), b->radius, RAYWHITE);
     }
+}
 
-    for (int i = 0; i < NUM_START_ASTEROIDS; i++) {
-        float radius = (float)GetRandomValue(35, 65);
-        Vector2 pos;
-        pos.x = (float)GetRandomValue((int)radius, (int)WIDTH - radius);
-        pos.y = (float)GetRandomValue((int)radius, (int)HEIGHT - radius);
-
-        int idx = findFreeAsteroidIndex();
-        if (idx == -1)
-            break;
+// HUD
+void DrawScore(int score) {
+    const char *text = TextFormat("SCORE: %d", score);
 
-        createAsteroid(idx, pos, radius, getRandV());
-    }
+    DrawText(text, 12, 12, 30, Fade(GREEN, 0.5f));
+    DrawText(text, 10, 10, 30, GREEN);
 }
 
-void resolveCollisions(Asteroid *a, Asteroid *b) {
-    Vector2 delta = Vector2Subtract(a->pos, b->pos);
-    float dsq = Vector2LengthSqr(delta);
-    float rsum = a->radius + b->radius;
-
-    if (dsq <= 0.0000001f || dsq >= rsum * rsum)
-        return;
+void DrawGameOverScreen() {
+    char *gameOverText = "GAME OVER";
+    char *restartText = "Press [R] to Restart";
+    int goWidth = MeasureText(gameOverText, 50);
+    int restartWidth = MeasureText(restartText, 30);
 
-    float dist = sqrtf(dsq);
-    Vector2 unitNormal = Vector2Scale(delta, 1.0f / dist);
-    Vector2 unitTangent = (Vector2){-unitNormal.y, unitNormal.x};
+    float pulse = 0.7f + 0.3f * sinf(GetTime() * 3.0f);
+    DrawText(gameOverText, WIDTH / 2 - goWidth / 2 + 2, HEIGHT / 2 - 22, 50,
+             Fade(RED, 0.5f * pulse));
+    DrawText(gameOverText, WIDTH / 2 - goWidth / 2, HEIGHT / 2 - 25, 50, RED);
 
-    Vector2 rv = Vector2Subtract(a->vel, b->vel);
-    float velAlongNormal = Vector2DotProduct(rv, unitNormal);
-    if (velAlongNormal > 0.0f)
-        return;
+    DrawText(restartText, WIDTH / 2 - restartWidth / 2 + 2, HEIGHT / 2 + 42, 30,
+             Fade(RAYWHITE, 0.5f));
+    DrawText(restartText, WIDTH / 2 - restartWidth / 2, HEIGHT / 2 + 40, 30, RAYWHITE);
+}
 
-    float overlap = rsum - dist;
-    float invMa = (a->mass > 0) ? 1.0f / a->mass : 0.0f;
-    float invMb = (b->mass > 0) ? 1.0f / b->mass : 0.0f;
-    float invSum = invMa + invMb;
-    if (invSum > 0.0f) {
-        Vector2 correction = Vector2Scale(unitNormal, overlap / invSum);
-        a->pos = Vector2Add(a->pos, Vector2Scale(correction, invMa));
-        b->pos = Vector2Subtract(b->pos, Vector2Scale(correction, invMb));
-    }
+void DrawWinScreen() {
+    char *winText = "VICTORY!";
+    char *restartText = "Press [R] to Restart";
+    int winWidth = MeasureText(winText, 50);
+    int restartWidth = MeasureText(restartText, 30);
 
-    float va_n = Vector2DotProduct(a->vel, unitNormal);
-    float va_t = Vector2DotProduct(a->vel, unitTangent);
-    float vb_n = Vector2DotProduct(b->vel, unitNormal);
-    float vb_t = Vector2DotProduct(b->vel, unitTangent);
+    DrawText(winText, WIDTH / 2 - winWidth / 2 + 2, HEIGHT / 2 - 22, 50, Fade(GREEN, 0.5f));
+    DrawText(winText, WIDTH / 2 - winWidth / 2, HEIGHT / 2 - 25, 50, GREEN);
 
-    float va_np = (va_n * (a->mass - b->mass) + 2.0f * b->mass * vb_n) / (a->mass + b->mass);
-    float vb_np = (vb_n * (b->mass - a->mass) + 2.0f * a->mass * va_n) / (a->mass + b->mass);
+    DrawText(restartText, WIDTH / 2 - restartWidth / 2 + 2, HEIGHT / 2 + 42, 30,
+             Fade(RAYWHITE, 0.5f));
+    DrawText(restartText, WIDTH / 2 - restartWidth / 2, HEIGHT / 2 + 40, 30, RAYWHITE);
+}
 
-    Vector2 va_np_vector = Vector2Scale(unitNormal, va_np);
-    Vector2 va_tp_vector = Vector2Scale(unitTangent, va_t);
-    Vector2 vb_np_vector = Vector2Scale(unitNormal, vb_np);
-    Vector2 vb_tp_vector = Vector2Scale(unitTangent, vb_t);
+// INPUT
+Input readInput() {
+    Input in;
+    in.right = IsKeyDown(KEY_RIGHT);
+    in.left = IsKeyDown(KEY_LEFT);
+    in.up = IsKeyDown(KEY_UP);
+    in.down = IsKeyDown(KEY_DOWN);
+    in.shoot = IsKeyPressed(KEY_SPACE);
+    in.restart = IsKeyPressed(KEY_R);
+    return in;
+}
 
-    Vector2 velFinal_A = Vector2Add(va_np_vector, va_tp_vector);
-    Vector2 velFinal_B = Vector2Add(vb_np_vector, vb_tp_vector);
+// Whether F9 should restore the quicksave this frame. Loading would desync a
+// recording from its seed, so it is off while recording.
+int quickloadPressed(const ReplayWriter *recorder) {
+    return IsKeyPressed(KEY_F9) && recorder == NULL;
+}
 
-    a->vel = velFinal_A;
-    b->vel = velFinal_B;
+// Whether this frame's keys change anything a tick would see.
+int inputChanged(Input latched, Input in) {
+    return in.right != latched.right || in.left != latched.left || in.up != latched.up ||
+           in.down != latched.down || in.shoot || in.restart;
+}
 
-    Vector2 collisionPoint = Vector2Add(a->pos, Vector2Scale(unitNormal, -a->radius));
-    for (int i = 0; i < 3; i++) {
-        Vector2 pVel = Vector2Scale(getRandV(), 1.5f);
-        createParticle(collisionPoint, pVel, (Color){255, 200, 100, 255}, 0.5f, 2.0f);
-    }
+// Held keys follow the latest frame; presses stick until a tick consumes them,
+// so a press on a frame that runs no tick is not lost.
+void latchInput(Input *latched, Input in) {
+    latched->right = in.right;
+    latched->left = in.left;
+    latched->up = in.up;
+    latched->down = in.down;
+    latched->shoot |= in.shoot;
+    latched->restart |= in.restart;
 }
 
-void checkCollisions() {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        for (int j = i + 1; j < MAX_ASTEROIDS; j++) {
-            Asteroid *a = &ASTEROIDS[i];
-            Asteroid *b = &ASTEROIDS[j];
+// RENDERING
+// Draws a captured tick blended alpha of the way from the previous tick to it.
+void drawGame(const RenderFrame *f, float alpha) {
+    Color bgColor = (Color){5, 5, 15, 255};
 
-            resolveCollisions(a, b);
-        }
+    ClearBackground(bgColor);
+    PROFILE(PHASE_DRAW_STARS, drawStars(f));
+    if (!f->gameOver) {
+        PROFILE(PHASE_DRAW_PARTICLES, drawParticles(f, alpha));
+        PROFILE(PHASE_DRAW_ASTEROIDS, drawPolygons(f, alpha));
+
+        profBegin(&PROFILER, PHASE_DRAW_HUD);
+        drawBullets(f, alpha);
+        DrawScore(f->score);
+        if (f->won)
+            DrawWinScreen();
+        profEnd(&PROFILER, PHASE_DRAW_HUD);
+    } else {
+        PROFILE(PHASE_DRAW_HUD, DrawGameOverScreen());
     }
 }
 
-void splitAsteroid(int parentIdx) {
-    Asteroid *p = &ASTEROIDS[parentIdx];
-    if (!p->active)
-        return;
+// PROFILER
+void drawProfilerOverlay() {
+    int x = WIDTH - 330;
+    int y = 10;
+    int lineHeight = 14;
 
-    int numParticles = (int)(p->radius / 5);
-    for (int i = 0; i < numParticles; i++) {
-        Vector2 pVel = Vector2Scale(getRandV(), 3.0f);
-        Color particleColor =
-            GetRandomValue(0, 1) ? (Color){255, 150, 50, 255} : (Color){255, 100, 30, 255};
-        createParticle(p->pos, pVel, particleColor, 1.0f, 4.0f);
+    DrawRectangle(x - 8, y - 6, 328, (PHASE_COUNT + 1) * lineHeight + 12, Fade(BLACK, 0.7f));
+    DrawText(TextFormat("%-18s %7s %7s %7s", "phase (ms)", "min", "avg", "p99"), x, y, 10, YELLOW);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        ProfStats s = profStats(&PROFILER, i);
+        y += lineHeight;
+        DrawText(TextFormat("%-18s %7.3f %7.3f %7.3f", PHASE_NAMES[i], s.min, s.avg, s.p99), x, y,
+                 10, RAYWHITE);
     }
+}
 
-    if (p->radius <= R_SMALL) {
-        p->active = 0;
-        return;
+void printProfilerSummary() {
+    printf("profile_window_ticks: %d\n", PROFILER.sampleCount);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        ProfStats s = profStats(&PROFILER, i);
+        if (s.avg > 0.0)
+            printf("profile_%s_ms: min=%.4f avg=%.4f p99=%.4f\n", PHASE_NAMES[i], s.min, s.avg,
+                   s.p99);
     }
+}
 
-    int childCount = 0;
-    float childRadius = 0.0f;
-
-    switch (p->size) {
-    case AST_BIG:
-        childCount = 3;
-        childRadius = p->radius * 0.55f;
-        break;
-    case AST_MED:
-        childCount = 2;
-        childRadius = p->radius * 0.60f;
-        break;
-    default:
-        p->active = 0;
-        return;
+// HEADLESS
+// Runs one tick, counting a round as won or lost when a restart ends it.
+void stepHeadless(World *w, Input in, float dt, int *wins, int *losses) {
+    if (in.restart) {
+        *wins += !w->game.gameOver && checkWin(w);
+        *losses += w->game.gameOver;
+    }
+    profBegin(&PROFILER, PHASE_FRAME);
+    updateGame(w, in, dt);
+    profEnd(&PROFILER, PHASE_FRAME);
+    profEndFrame(&PROFILER);
+}
+
+void printRunSummary(const World *w, uint64_t seed, int tickHz, long ticks, double elapsed,
+                     int wins, int losses) {
+    const char *result = w->game.gameOver ? "gameover" : checkWin(w) ? "win" : "running";
+    printf("seed: %llu\n", (unsigned long long)seed);
+    printf("tick_hz: %d\n", tickHz);
+    printf("particle_kernel: %s\n", particleKernelName(particleKernel));
+    printf("ticks: %ld\n", ticks);
+    printf("elapsed_s: %.6f\n", elapsed);
+    printf("ticks_per_sec: %.1f\n", elapsed > 0.0 ? (double)ticks / elapsed : 0.0);
+    printf("wins: %d\n", wins);
+    printf("gameovers: %d\n", losses);
+    printf("result: %s\n", result);
+    printf("score: %d\n", w->game.score);
+    printf("asteroids: %d\n", w->asteroids.count);
+    printf("particles: %d\n", w->particles.count);
+    printf("asteroid_drops: %ld\n", w->poolStats.asteroidDrops);
+    printf("particle_drops: %ld\n", w->poolStats.particleDrops);
+    printf("particle_evictions: %ld\n", w->poolStats.particleEvictions);
+    printf("bullet_drops: %ld\n", w->poolStats.bulletDrops);
+    printf("pool_growths: %ld\n", w->poolStats.growths);
+    printf("state_hash: %016llx\n", (unsigned long long)hashWorld(w));
+    if (PROFILER.enabled)
+        printProfilerSummary();
+}
+
+// Runs the simulation for a fixed number of ticks without a window or any
+// drawing. The ship holds fire and never moves, and each round is restarted as
+// soon as it ends, so bullets, splits, debris and game-over all get exercised.
+// The run can start from a snapshot and leave one behind when it finishes.
+int runHeadless(World *w, long ticks, unsigned int seed, int tickHz, const char *loadPath,
+                const char *savePath) {
+    seedWorld(w, seed);
+    initGame(w);
+    if (loadPath != NULL && !loadSnapshotFile(w, loadPath)) {
+        fprintf(stderr, "cannot load snapshot: %s\n", loadPath);
+        return 1;
     }
 
-    Vector2 initPos = p->pos;
-    p->active = 0;
+    Input in = {0};
+    in.shoot = 1;
 
-    for (int i = 0; i < childCount; i++) {
-        int idx = findFreeAsteroidIndex();
-        if (idx == -1)
-            return;
+    int wins = 0;
+    int losses = 0;
 
-        Vector2 jitter = Vector2Scale(getRandV(), childRadius * 0.35f);
-        Vector2 cPos = Vector2Add(initPos, jitter);
+    double start = profNow();
+    for (long t = 0; t < ticks; t++) {
+        in.restart = w->game.gameOver || checkWin(w);
+        stepHeadless(w, in, 1.0f / tickHz, &wins, &losses);
+    }
+    double elapsed = profNow() - start;
 
-        Vector2 velDir = getRandV();
-        createAsteroid(idx, cPos, childRadius, velDir);
-        ASTEROIDS[idx].vel = Vector2Scale(ASTEROIDS[idx].vel, 1.3f);
+    printRunSummary(w, seed, tickHz, ticks, elapsed, wins, losses);
+    if (savePath != NULL && !saveSnapshotFile(w, savePath)) {
+        fprintf(stderr, "cannot save snapshot: %s\n", savePath);
+        return 1;
     }
+    return 0;
 }
 
-void UpdateAsteroids() {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        Asteroid *a = &ASTEROIDS[i];
-        if (!a->active)
-            continue;
-
-        a->pos.x += a->vel.x * SCALE;
-        a->pos.y += a->vel.y * SCALE;
+// Feeds a recorded session back through the simulation as fast as possible.
+// Fails if the final state differs from the one stored in the log.
+int runReplay(World *w, ReplayReader *replay) {
+    const ReplayHeader *h = &replay->header;
+    seedWorld(w, h->seed);
+    initGame(w);
 
-        if (a->pos.x + a->radius < 0)
-            a->pos.x = WIDTH;
-        if (a->pos.x - a->radius > WIDTH)
-            a->pos.x = 0;
-        if (a->pos.y + a->radius < 0)
-            a->pos.y = HEIGHT;
-        if (a->pos.y - a->radius > HEIGHT)
-            a->pos.y = 0;
+    int wins = 0;
+    int losses = 0;
+    long ticks = 0;
+    Input in;
 
-        a->rotation += SCALE;
+    double start = profNow();
+    while (replayRead(replay, &in)) {
+        stepHeadless(w, in, 1.0f / h->tickHz, &wins, &losses);
+        ticks++;
     }
-}
+    double elapsed = profNow() - start;
+
+    printRunSummary(w, h->seed, h->tickHz, ticks, elapsed, wins, losses);
+    int match = ticks == h->ticks && hashWorld(w) == h->finalHash;
+    printf("replay_match: %s\n", match ? "yes" : "no");
+    return match ? 0 : 1;
+}
+
+// WINDOW
+// Ticks and draws on this thread: each frame runs however many fixed ticks
+// the elapsed time calls for, then draws between the last two. Input latency
+// is measured from the frame that saw a change to the first tick after it.
+void runWindowed(World *w, int tickHz, ReplayWriter *recorder) {
+    float dt = 1.0f / tickHz;
+    float accumulator = 0.0f;
+    Input input = {0};
+    InputLatency latency = {0, 0.0, 0.0};
+    double changedAt = -1.0;
+    RenderFrame frame;
+    memset(&frame, 0, sizeof(frame));
 
-void DrawAsteroids() {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        Asteroid *a = &ASTEROIDS[i];
-        if (a->active) {
-            Color baseColor = RAYWHITE;
-            if (a->hits >= a->maxHits - 1) {
-                baseColor = (Color){255, 150, 150, 255};
-            } else if (a->hits > 0) {
-                baseColor = (Color){255, 200, 200, 255};
+    while (!WindowShouldClose()) {
+        profBegin(&PROFILER, PHASE_FRAME);
+        accumulator += fminf(GetFrameTime(), MAX_FRAME_TIME);
+        Input in = readInput();
+        if (changedAt < 0.0 && inputChanged(input, in))
+            changedAt = profNow();
+        latchInput(&input, in);
+        if (IsKeyPressed(KEY_F3)) {
+            showProfiler = !showProfiler;
+            PROFILER.enabled = showProfiler || PROFILER.csv != NULL;
+        }
+        if (IsKeyPressed(KEY_F5) && !saveSnapshotFile(w, QUICKSAVE_PATH))
+            fprintf(stderr, "cannot save snapshot: %s\n", QUICKSAVE_PATH);
+        if (quickloadPressed(recorder) && !loadSnapshotFile(w, QUICKSAVE_PATH))
+            fprintf(stderr, "cannot load snapshot: %s\n", QUICKSAVE_PATH);
+
+        while (accumulator >= dt) {
+            if (changedAt >= 0.0) {
+                recordInputLatency(&latency, profNow() - changedAt);
+                changedAt = -1.0;
             }
-            DrawPoly(a->pos, a->sides, a->radius, a->rotation, baseColor);
+            if (recorder != NULL)
+                replayWrite(recorder, input);
+            updateGame(w, input, dt);
+            input.shoot = 0;
+            input.restart = 0;
+            accumulator -= dt;
         }
-    }
-}
 
-// SPACESHIP
-Vector2 initialSpaceshipPosition() {
-    Vector2 center = {(float)WIDTH / 2, (float)HEIGHT / 2};
-    Vector2 avg = {0.0f, 0.0f};
-    for (int i = 0; i < NUM_START_ASTEROIDS; i++) {
-        avg.x += ASTEROIDS[i].pos.x;
-        avg.y += ASTEROIDS[i].pos.y;
-    }
-    avg.x /= NUM_START_ASTEROIDS;
-    avg.y /= NUM_START_ASTEROIDS;
-
-    Vector2 dir = {center.x - avg.x, center.y - avg.y};
-    Vector2 shipPos = {center.x + dir.x, center.y + dir.y};
-
-    if (shipPos.x < 0)
-        shipPos.x = 0;
-    if (shipPos.y < 0)
-        shipPos.y = 0;
-    if (shipPos.x > WIDTH)
-        shipPos.x = WIDTH;
-    if (shipPos.y > HEIGHT)
-        shipPos.y = HEIGHT;
+        captureFrame(&frame, w, 0.0);
+        BeginDrawing();
+        drawGame(&frame, accumulator / dt);
+        if (showProfiler)
+            drawProfilerOverlay();
+        PROFILE(PHASE_PRESENT, EndDrawing());
 
-    return shipPos;
+        profEnd(&PROFILER, PHASE_FRAME);
+        profEndFrame(&PROFILER);
+    }
+    freeFrame(&frame);
+    printInputLatency(&latency);
 }
 
-Spaceship initSpaceship() { return (Spaceship){initialSpaceshipPosition(), 10, (Vector2){0, 0}}; }
-
-void MoveSpaceship(Spaceship *s) {
-    if (IsKeyDown(KEY_RIGHT))
-        s->pos.x += VEL;
-    if (IsKeyDown(KEY_LEFT))
-        s->pos.x -= VEL;
-    if (IsKeyDown(KEY_UP))
-        s->pos.y -= VEL;
-    if (IsKeyDown(KEY_DOWN))
-        s->pos.y += VEL;
+// SIM THREAD
+// Input reaches the sim thread as timestamped events on a lock-free queue.
+// The window thread owns posted (the held keys it has queued so far); the sim
+// thread owns held (the keys as of its last tick).
+typedef struct {
+    World *world;
+    ReplayWriter *recorder;
+    int tickHz;
+    FrameBuffer frames;
+    InputQueue input;
+    Input posted;
+    Input held;
+    InputLatency latency;
+    atomic_int running;
+} SimThread;
+
+// Queues a transition if the key changed since the last one queued. If the
+// queue is full it is retried on the next frame.
+void postHeldKey(InputQueue *q, int *posted, int down, InputKey key, double now) {
+    if (down != *posted && pushInputEvent(q, (InputEvent){now, (uint8_t)key, (uint8_t)down}))
+        *posted = down;
+}
+
+// A press that finds the queue full is dropped, as a missed frame would drop it.
+void postPress(InputQueue *q, int pressed, InputKey key, double now) {
+    if (pressed)
+        pushInputEvent(q, (InputEvent){now, (uint8_t)key, 1});
+}
+
+// GLFW only lets the main thread poll for input, so events are still sampled
+// once per rendered frame, but stamped with when they were seen and handed
+// to the tick they fall in rather than to whichever tick runs next.
+void postInput(SimThread *st, Input in, int quicksave, int quickload) {
+    double now = profNow();
+    InputQueue *q = &st->input;
+    postHeldKey(q, &st->posted.right, in.right, INPUT_KEY_RIGHT, now);
+    postHeldKey(q, &st->posted.left, in.left, INPUT_KEY_LEFT, now);
+    postHeldKey(q, &st->posted.up, in.up, INPUT_KEY_UP, now);
+    postHeldKey(q, &st->posted.down, in.down, INPUT_KEY_DOWN, now);
+    postPress(q, in.shoot, INPUT_KEY_SHOOT, now);
+    postPress(q, in.restart, INPUT_KEY_RESTART, now);
+    postPress(q, quicksave, INPUT_KEY_QUICKSAVE, now);
+    postPress(q, quickload, INPUT_KEY_QUICKLOAD, now);
+}
+
+// Applies every event stamped at or before this tick's due time. Later ones
+// stay queued for the tick they fall in.
+void takeInput(SimThread *st, double due, double now) {
+    InputEvent e;
+    while (peekInputEvent(&st->input, &e) && e.time <= due) {
+        if (!applyInputEvent(&st->held, e)) {
+            if (e.key == INPUT_KEY_QUICKSAVE && !saveSnapshotFile(st->world, QUICKSAVE_PATH))
+                fprintf(stderr, "cannot save snapshot: %s\n", QUICKSAVE_PATH);
+            if (e.key == INPUT_KEY_QUICKLOAD && !loadSnapshotFile(st->world, QUICKSAVE_PATH))
+                fprintf(stderr, "cannot load snapshot: %s\n", QUICKSAVE_PATH);
+        }
+        recordInputLatency(&st->latency, now - e.time);
+        popInputEvent(&st->input);
+    }
 }
 
-void UpdateSpaceship(Spaceship *s) {
-    MoveSpaceship(s);
-    s->pos.x += s->vel.x * VEL;
-    s->pos.y += s->vel.y * VEL;
+void sleepSeconds(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
 }
 
-void DrawSpaceShip(Spaceship *s) {
-    DrawPoly(s->pos, 3, s->radius * 1.1f, 120, (Color){100, 180, 255, 255});
-    DrawPoly(s->pos, 3, s->radius, 120, (Color){150, 200, 255, 255});
-    DrawPoly(s->pos, 3, s->radius * 0.6f, 120, (Color){200, 230, 255, 255});
-}
+// Runs each tick when it falls due and publishes a frame stamped with that
+// time. A sim that falls more than MAX_FRAME_TIME behind (say, stopped in a
+// debugger) drops the backlog rather than racing to catch up.
+void *simMain(void *arg) {
+    SimThread *st = arg;
+    double dt = 1.0 / st->tickHz;
+    double due = profNow();
 
-// BULLETS
-void createBullet(Vector2 pos, Vector2 velDir) {
-    for (int i = 0; i < NUM_BULLETS; i++) {
-        if (!bulletActive[i]) {
-            BULLETS[i] = (Bullet){pos, 3, velDir};
-            bulletActive[i] = 1;
-            return;
+    while (atomic_load(&st->running)) {
+        double now = profNow();
+        if (now < due) {
+            sleepSeconds(due - now);
+            continue;
         }
+        if (now - due > MAX_FRAME_TIME)
+            due = now;
+
+        takeInput(st, due, now);
+        if (st->recorder != NULL)
+            replayWrite(st->recorder, st->held);
+        updateGame(st->world, st->held, (float)dt);
+        st->held.shoot = 0;
+        st->held.restart = 0;
+        publishFrame(&st->frames, st->world, due);
+        due += dt;
     }
-
-    BULLETS[0] = (Bullet){pos, 3, velDir};
-    bulletActive[0] = 1;
-}
-
-void drawBullets() {
-    for (int i = 0; i < NUM_BULLETS; i++) {
-        if (!bulletActive[i])
-            continue;
-        Bullet *b = &BULLETS[i];
-        DrawCircle(b->pos.x, b->pos.y, b->radius, RAYWHITE);
+    return NULL;
+}
+
+// Runs the simulation on its own thread while this one polls input and draws
+// whichever frame was published last, so vsync waits and slow frames no
+// longer hold up ticks, and a slow tick no longer holds up a frame. Returns 0
+// if the thread could not be started.
+int runPipelined(World *w, int tickHz, ReplayWriter *recorder) {
+    SimThread st;
+    st.world = w;
+    st.recorder = recorder;
+    st.tickHz = tickHz;
+    initFrameBuffer(&st.frames);
+    initInputQueue(&st.input);
+    memset(&st.posted, 0, sizeof(st.posted));
+    memset(&st.held, 0, sizeof(st.held));
+    memset(&st.latency, 0, sizeof(st.latency));
+    atomic_init(&st.running, 1);
+    publishFrame(&st.frames, w, profNow());
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, simMain, &st) != 0) {
+        freeFrameBuffer(&st.frames);
+        return 0;
     }
-}
 
-void updateBullets() {
-    for (int i = 0; i < NUM_BULLETS; i++) {
-        if (!bulletActive[i])
-            continue;
-        Bullet *b = &BULLETS[i];
+    while (!WindowShouldClose()) {
+        postInput(&st, readInput(), IsKeyPressed(KEY_F5), quickloadPressed(recorder));
 
-        if (b->pos.x + b->radius < 0 || b->pos.x - b->radius > WIDTH || b->pos.y + b->radius < 0 ||
-            b->pos.y - b->radius > HEIGHT) {
-            bulletActive[i] = 0;
-        }
+        const RenderFrame *f = acquireFrame(&st.frames);
+        float alpha = Clamp((float)((profNow() - f->tickTime) * tickHz), 0.0f, 1.0f);
+        BeginDrawing();
+        drawGame(f, alpha);
+        EndDrawing();
     }
-}
 
-void moveBullet() {
-    for (int i = 0; i < NUM_BULLETS; i++) {
-        if (!bulletActive[i])
-            continue;
-        Bullet *b = &BULLETS[i];
-        b->pos.x += b->vel.x * BULLET_SPEED;
-        b->pos.y += b->vel.y * BULLET_SPEED;
-    }
+    atomic_store(&st.running, 0);
+    pthread_join(thread, NULL);
+    freeFrameBuffer(&st.frames);
+    printInputLatency(&st.latency);
+    return 1;
 }
 
-void handleBulletAsteroidCollisions(int *score) {
-    for (int bulletIdx = 0; bulletIdx < NUM_BULLETS; bulletIdx++) {
-        if (!bulletActive[bulletIdx])
-            continue;
-        Bullet *b = &BULLETS[bulletIdx];
-
-        for (int astIdx = 0; astIdx < MAX_ASTEROIDS; astIdx++) {
-            Asteroid *a = &ASTEROIDS[astIdx];
-            if (!a->active)
-                continue;
-
-            float dx = b->pos.x - a->pos.x;
-            float dy = b->pos.y - a->pos.y;
-            float r = b->radius + a->radius;
-
-            if (dx * dx + dy * dy <= r * r) {
-                bulletActive[bulletIdx] = 0;
-                a->hits++;
-                if (a->hits >= a->maxHits) {
-                    splitAsteroid(astIdx);
-                    (*score) += 10;
-                }
-                break;
-            }
+// MAIN ENTRY POINT
+void printUsage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--broadphase brute|grid|sap] [--collision-solver sequential|colored]\n"
+            "       [--hz N] [--headless] [--ticks N] [--seed S]\n"
+            "       [--max-asteroids N] [--max-particles N] [--max-bullets N] [--max-stars N]\n"
+            "       [--grow] [--particle-kernel auto|scalar|sse2|avx2]\n"
+            "       [--profile] [--profile-csv PATH] [--record PATH] [--replay PATH]\n"
+            "       [--load-snapshot PATH] [--save-snapshot PATH] [--jobs N]\n"
+            "       [--jobs-deterministic] [--sim-thread]\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    int headless = 0;
+    int ticks = HEADLESS_DEFAULT_TICKS;
+    int hasSeed = 0;
+    unsigned int seed = 0;
+    int tickHz = DEFAULT_TICK_HZ;
+    const char *profileCsv = NULL;
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    const char *loadSnapshotPath = NULL;
+    const char *saveSnapshotPath = NULL;
+    PoolConfig pools = DEFAULT_POOL_CONFIG;
+    int jobWorkers = 0;
+    int jobsDeterministic = 0;
+    int simThread = 0;
+
+    profInit(&PROFILER, PHASE_NAMES, PHASE_COUNT);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+            if (!parseBroadphaseMode(argv[++i], &broadphaseMode))
+                return 1;
+        } else if (strcmp(argv[i], "--collision-solver") == 0 && i + 1 < argc) {
+            if (!parseCollisionSolver(argv[++i], &collisionSolver))
+                return 1;
+        } else if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &tickHz))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--max-asteroids") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &pools.maxAsteroids))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--max-particles") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &pools.maxParticles))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--max-bullets") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &pools.maxBullets))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--max-stars") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &pools.maxStars))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            PROFILER.enabled = 1;
+            showProfiler = 1;
+        } else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            profileCsv = argv[++i];
+            PROFILER.enabled = 1;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &jobWorkers))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--jobs-deterministic") == 0) {
+            jobsDeterministic = 1;
+        } else if (strcmp(argv[i], "--sim-thread") == 0) {
+            simThread = 1;
+        } else if (strcmp(argv[i], "--grow") == 0) {
+            pools.growable = 1;
+        } else if (strcmp(argv[i], "--particle-kernel") == 0 && i + 1 < argc) {
+            if (!parseParticleKernel(argv[++i], &particleKernel))
+                return 1;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--load-snapshot") == 0 && i + 1 < argc) {
+            loadSnapshotPath = argv[++i];
+        } else if (strcmp(argv[i], "--save-snapshot") == 0 && i + 1 < argc) {
+            saveSnapshotPath = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &ticks))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+            hasSeed = 1;
+        } else {
+            printUsage(argv[0]);
+            return 1;
         }
     }
-}
-
-void tempDisableShooting(float seconds, int *shootingEnabled, double *startTime) {
-    double currentTime = GetTime();
 
-    if (!(*shootingEnabled)) {
-        if ((currentTime - *startTime) >= seconds)
-            *shootingEnabled = 1;
+    // The profiler keeps one set of per-frame timers, so it can't time two threads.
+    if (simThread && PROFILER.enabled) {
+        fprintf(stderr, "--sim-thread cannot be combined with --profile or --profile-csv\n");
+        return 1;
     }
-}
 
-void Shoot(Spaceship *s, int *score, int *shootingEnabled, double *startTime) {
-    if (*shootingEnabled && IsKeyPressed(KEY_SPACE)) {
-        Vector2 position = s->pos;
-        createBullet(position, (Vector2){1, 0});
-        *shootingEnabled = 0;
-        *startTime = GetTime();
+    // Headless runs feed a fixed policy, not keys, so there is nothing to record.
+    if (headless && recordPath != NULL) {
+        fprintf(stderr, "--record cannot be combined with --headless\n");
+        return 1;
     }
-    moveBullet();
-    updateBullets();
-    handleBulletAsteroidCollisions(score);
-    drawBullets();
-}
 
-// GAME-OVER / WIN
-void checkGameOver(Spaceship *s, int *gameOver) {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        Asteroid *a = &ASTEROIDS[i];
-        if (!a->active)
-            continue;
-        float dx = s->pos.x - a->pos.x;
-        float dy = s->pos.y - a->pos.y;
-        float r = s->radius + a->radius;
-        if (dx * dx + dy * dy <= r * r) {
-            *gameOver = 1;
-            return;
+    // A replay brings its own seed, tick rate, pool sizes and collision setup.
+    ReplayReader replay;
+    if (replayPath != NULL) {
+        if (!replayOpenRead(&replay, replayPath)) {
+            fprintf(stderr, "cannot read replay: %s\n", replayPath);
+            return 1;
         }
+        tickHz = replay.header.tickHz;
+        pools = replay.header.pools;
+        broadphaseMode = replay.header.broadphase;
+        collisionSolver = replay.header.solver;
     }
-}
-
-int checkWin() {
-    for (int i = 0; i < MAX_ASTEROIDS; i++) {
-        if (ASTEROIDS[i].active)
-            return 0;
-    }
-    return 1;
-}
-
-void DrawScore(int *score) {
-    const char *text = TextFormat("SCORE: %d", *score);
-
-    DrawText(text, 12, 12, 30, Fade(GREEN, 0.5f));
-    DrawText(text, 10, 10, 30, GREEN);
-}
-
-void DrawGameOverScreen() {
-    char *gameOverText = "GAME OVER";
-    char *restartText = "Press [R] to Restart";
-    int goWidth = MeasureText(gameOverText, 50);
-    int restartWidth = MeasureText(restartText, 30);
 
-    float pulse = 0.7f + 0.3f * sinf(GetTime() * 3.0f);
-    DrawText(gameOverText, WIDTH / 2 - goWidth / 2 + 2, HEIGHT / 2 - 22, 50,
-             Fade(RED, 0.5f * pulse));
-    DrawText(gameOverText, WIDTH / 2 - goWidth / 2, HEIGHT / 2 - 25, 50, RED);
+    particleKernel = resolveParticleKernel(particleKernel);
 
-    DrawText(restartText, WIDTH / 2 - restartWidth / 2 + 2, HEIGHT / 2 + 42, 30,
-             Fade(RAYWHITE, 0.5f));
-    DrawText(restartText, WIDTH / 2 - restartWidth / 2, HEIGHT / 2 + 40, 30, RAYWHITE);
-}
+    JobSystem jobs;
+    if (jobWorkers > 0) {
+        if (!jobsInit(&jobs, jobWorkers, jobsDeterministic)) {
+            fprintf(stderr, "cannot start %d job workers\n", jobWorkers);
+            return 1;
+        }
+        jobSystem = &jobs;
+    }
 
-void DrawWinScreen() {
-    char *winText = "VICTORY!";
-    char *restartText = "Press [R] to Restart";
-    int winWidth = MeasureText(winText, 50);
-    int restartWidth = MeasureText(restartText, 30);
+    World world;
+    initWorld(&world, pools, DEFAULT_SPAWN_CONFIG);
 
-    DrawText(winText, WIDTH / 2 - winWidth / 2 + 2, HEIGHT / 2 - 22, 50, Fade(GREEN, 0.5f));
-    DrawText(winText, WIDTH / 2 - winWidth / 2, HEIGHT / 2 - 25, 50, GREEN);
+    if (profileCsv != NULL && !profOpenCsv(&PROFILER, profileCsv)) {
+        fprintf(stderr, "cannot open profile CSV: %s\n", profileCsv);
+        return 1;
+    }
 
-    DrawText(restartText, WIDTH / 2 - restartWidth / 2 + 2, HEIGHT / 2 + 42, 30,
-             Fade(RAYWHITE, 0.5f));
-    DrawText(restartText, WIDTH / 2 - restartWidth / 2, HEIGHT / 2 + 40, 30, RAYWHITE);
-}
+    if (replayPath != NULL) {
+        int rc = runReplay(&world, &replay);
+        replayCloseRead(&replay);
+        profClose(&PROFILER);
+        freeWorld(&world);
+        if (jobSystem != NULL)
+            jobsShutdown(jobSystem);
+        return rc;
+    }
 
-void restartGame(int *gameOver, int *score, Spaceship *spaceship) {
-    initAsteroids();
-    *spaceship = initSpaceship();
-    *score = 0;
-    *gameOver = 0;
-}
+    if (headless) {
+        int rc = runHeadless(&world, ticks, hasSeed ? seed : (unsigned int)time(NULL), tickHz,
+                             loadSnapshotPath, saveSnapshotPath);
+        profClose(&PROFILER);
+        freeWorld(&world);
+        if (jobSystem != NULL)
+            jobsShutdown(jobSystem);
+        return rc;
+    }
 
-// MAIN ENTRY POINT
-int main(void) {
+    SetConfigFlags(FLAG_VSYNC_HINT);
     InitWindow(WIDTH, HEIGHT, "Asteroid");
-    SetTargetFPS(60);
-
-    initAsteroids();
-    initStars();
-    Spaceship spaceship = initSpaceship();
-
-    int gameOver = 0;
-    int score = 0;
-    int shootingEnabled = 1;
-    double shootingStartTime = 0.0f;
+    int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+    SetTargetFPS(refreshRate > 0 ? refreshRate : 60);
+    if (!hasSeed)
+        seed = (unsigned int)time(NULL);
+    seedWorld(&world, seed);
+
+    ReplayWriter recorder;
+    if (recordPath != NULL) {
+        ReplayHeader header = {seed, tickHz, pools, broadphaseMode, collisionSolver, 0, 0};
+        if (!replayOpenWrite(&recorder, recordPath, header)) {
+            fprintf(stderr, "cannot open recording: %s\n", recordPath);
+            CloseWindow();
+            return 1;
+        }
+    }
 
-    Color bgColor = (Color){5, 5, 15, 255};
+    initParticleSprite();
+    initUnitPolygons();
 
-    for (int i = 0; i < MAX_PARTICLES; i++)
-        PARTICLES[i].lifetime = 0;
+    initGame(&world);
 
-    while (!WindowShouldClose()) {
-        BeginDrawing();
-        ClearBackground(bgColor);
-        drawStars();
-        if (!gameOver) {
-            DrawScore(&score);
-            UpdateAsteroids();
-            UpdateSpaceship(&spaceship);
-            checkCollisions();
-            updateParticles();
-            drawParticles();
-            DrawAsteroids();
-            DrawSpaceShip(&spaceship);
-            tempDisableShooting(0.3f, &shootingEnabled, &shootingStartTime);
-            Shoot(&spaceship, &score, &shootingEnabled, &shootingStartTime);
-            checkGameOver(&spaceship, &gameOver);
-
-            if (checkWin()) {
-                DrawWinScreen();
-                if (IsKeyPressed(KEY_R)) {
-                    restartGame(&gameOver, &score, &spaceship);
-                }
-            }
-        } else {
-            DrawGameOverScreen();
-            if (IsKeyPressed(KEY_R))
-                restartGame(&gameOver, &score, &spaceship);
-        }
-
-        EndDrawing();
+    int rc = 0;
+    if (!simThread) {
+        runWindowed(&world, tickHz, recordPath != NULL ? &recorder : NULL);
+    } else if (!runPipelined(&world, tickHz, recordPath != NULL ? &recorder : NULL)) {
+        fprintf(stderr, "cannot start simulation thread\n");
+        rc = 1;
     }
 
+    if (recordPath != NULL && !replayCloseWrite(&recorder, hashWorld(&world)))
+        fprintf(stderr, "failed to write recording: %s\n", recordPath);
+    profClose(&PROFILER);
+    UnloadTexture(particleSprite);
     CloseWindow();
+    freeWorld(&world);
+    if (jobSystem != NULL)
+        jobsShutdown(jobSystem);
 
-    return 0;
+    return rc;
 }
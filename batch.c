@@ -0,0 +1,302 @@
+#include "game.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// CONSTANTS
+#define BATCH_DEFAULT_WORLDS 1000
+#define BATCH_DEFAULT_TICKS 36000
+#define BATCH_DEFAULT_SEED 1
+#define BATCH_MAX_THREADS 256
+
+// TYPES
+typedef enum {
+    OUTCOME_WIN,
+    OUTCOME_LOSS,
+    OUTCOME_TIMEOUT,
+} Outcome;
+
+typedef struct {
+    uint64_t seed;
+    Outcome outcome;
+    long ticks;
+    int score;
+} WorldResult;
+
+// Worlds are handed out one at a time from an atomic counter and each result
+// lands at its world's index, so the aggregate never depends on how many
+// threads ran or in which order they finished.
+typedef struct {
+    long worldCount;
+    long maxTicks;
+    uint64_t seed;
+    int tickHz;
+    PoolConfig pools;
+    SpawnConfig spawn;
+    WorldResult *results;
+    atomic_long next;
+} Batch;
+
+// HELPERS
+// splitmix64 finalizer, so neighbouring world indices get unrelated seeds.
+uint64_t worldSeed(uint64_t base, long index) {
+    uint64_t z = base + (uint64_t)(index + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+int compareLongs(const void *a, const void *b) {
+    long x = *(const long *)a;
+    long y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+const char *outcomeName(Outcome o) {
+    switch (o) {
+    case OUTCOME_WIN:
+        return "win";
+    case OUTCOME_LOSS:
+        return "loss";
+    case OUTCOME_TIMEOUT:
+        return "timeout";
+    }
+    return "unknown";
+}
+
+// RUNNER
+// Plays one round with the headless policy (hold fire, never move) until it
+// is won, lost or runs out of ticks. The world is reused between rounds, so
+// pools keep any capacity they grew.
+WorldResult playWorld(World *w, const Batch *b, uint64_t seed) {
+    WorldResult r = {seed, OUTCOME_TIMEOUT, 0, 0};
+    seedWorld(w, seed);
+    memset(&w->poolStats, 0, sizeof(w->poolStats));
+    initGame(w);
+
+    Input in = {0};
+    in.shoot = 1;
+    float dt = 1.0f / b->tickHz;
+
+    while (r.ticks < b->maxTicks) {
+        updateGame(w, in, dt);
+        r.ticks++;
+        if (w->game.gameOver) {
+            r.outcome = OUTCOME_LOSS;
+            break;
+        }
+        if (checkWin(w)) {
+            r.outcome = OUTCOME_WIN;
+            break;
+        }
+    }
+    r.score = w->game.score;
+    return r;
+}
+
+void *batchWorker(void *arg) {
+    Batch *b = arg;
+    World w;
+    initWorld(&w, b->pools, b->spawn);
+
+    for (;;) {
+        long i = atomic_fetch_add(&b->next, 1);
+        if (i >= b->worldCount)
+            break;
+        b->results[i] = playWorld(&w, b, worldSeed(b->seed, i));
+    }
+
+    freeWorld(&w);
+    return NULL;
+}
+
+// REPORT
+long percentile(const long *sorted, long n, int p) { return sorted[(n - 1) * p / 100]; }
+
+void printReport(const Batch *b, int threads, double elapsed) {
+    long n = b->worldCount;
+    long wins = 0, losses = 0, timeouts = 0;
+    long *clearTicks = malloc(sizeof(long) * n);
+    long *scores = malloc(sizeof(long) * n);
+    double clearSum = 0.0, scoreSum = 0.0;
+
+    for (long i = 0; i < n; i++) {
+        const WorldResult *r = &b->results[i];
+        wins += r->outcome == OUTCOME_WIN;
+        losses += r->outcome == OUTCOME_LOSS;
+        timeouts += r->outcome == OUTCOME_TIMEOUT;
+        if (r->outcome == OUTCOME_WIN) {
+            clearTicks[wins - 1] = r->ticks;
+            clearSum += r->ticks;
+        }
+        scores[i] = r->score;
+        scoreSum += r->score;
+    }
+    qsort(clearTicks, wins, sizeof(long), compareLongs);
+    qsort(scores, n, sizeof(long), compareLongs);
+
+    printf("worlds: %ld\n", n);
+    printf("threads: %d\n", threads);
+    printf("seed: %llu\n", (unsigned long long)b->seed);
+    printf("tick_hz: %d\n", b->tickHz);
+    printf("max_ticks: %ld\n", b->maxTicks);
+    printf("start_asteroids: %d\n", b->spawn.startAsteroids);
+    printf("radius: %d-%d\n", b->spawn.minRadius, b->spawn.maxRadius);
+    printf("elapsed_s: %.6f\n", elapsed);
+    printf("worlds_per_sec: %.1f\n", elapsed > 0.0 ? n / elapsed : 0.0);
+    printf("win_rate: %.4f\n", (double)wins / n);
+    printf("loss_rate: %.4f\n", (double)losses / n);
+    printf("timeout_rate: %.4f\n", (double)timeouts / n);
+    if (wins > 0)
+        printf("ticks_to_clear: mean=%.1f p10=%ld p50=%ld p90=%ld\n", clearSum / wins,
+               percentile(clearTicks, wins, 10), percentile(clearTicks, wins, 50),
+               percentile(clearTicks, wins, 90));
+    printf("score: mean=%.1f min=%ld p10=%ld p50=%ld p90=%ld max=%ld\n", scoreSum / n, scores[0],
+           percentile(scores, n, 10), percentile(scores, n, 50), percentile(scores, n, 90),
+           scores[n - 1]);
+
+    printf("score_histogram:");
+    for (long i = 0; i < n;) {
+        long j = i;
+        while (j < n && scores[j] == scores[i])
+            j++;
+        printf(" %ld:%ld", scores[i], j - i);
+        i = j;
+    }
+    printf("\n");
+
+    free(clearTicks);
+    free(scores);
+}
+
+int writeResultsCsv(const Batch *b, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+        return 0;
+    fprintf(f, "world,seed,outcome,ticks,score\n");
+    for (long i = 0; i < b->worldCount; i++) {
+        const WorldResult *r = &b->results[i];
+        fprintf(f, "%ld,%llu,%s,%ld,%d\n", i, (unsigned long long)r->seed,
+                outcomeName(r->outcome), r->ticks, r->score);
+    }
+    return fclose(f) == 0;
+}
+
+// MAIN ENTRY POINT
+void printUsage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--worlds N] [--threads N] [--ticks N] [--seed S] [--hz N]\n"
+            "       [--start-asteroids N] [--min-radius R] [--max-radius R]\n"
+            "       [--max-asteroids N] [--max-particles N] [--max-bullets N] [--grow]\n"
+            "       [--broadphase brute|grid|sap] [--particle-kernel auto|scalar|sse2|avx2]\n"
+            "       [--collision-solver sequential|colored] [--results-csv PATH]\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    Batch b;
+    memset(&b, 0, sizeof(b));
+    b.seed = BATCH_DEFAULT_SEED;
+    b.tickHz = DEFAULT_TICK_HZ;
+    b.pools = DEFAULT_POOL_CONFIG;
+    b.spawn = DEFAULT_SPAWN_CONFIG;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 1;
+    const char *resultsCsv = NULL;
+    int worlds = BATCH_DEFAULT_WORLDS;
+    int maxTicks = BATCH_DEFAULT_TICKS;
+
+    for (int i = 1; i < argc; i++) {
+        int *target = NULL;
+        if (strcmp(argv[i], "--worlds") == 0)
+            target = &worlds;
+        else if (strcmp(argv[i], "--threads") == 0)
+            target = &threads;
+        else if (strcmp(argv[i], "--ticks") == 0)
+            target = &maxTicks;
+        else if (strcmp(argv[i], "--hz") == 0)
+            target = &b.tickHz;
+        else if (strcmp(argv[i], "--start-asteroids") == 0)
+            target = &b.spawn.startAsteroids;
+        else if (strcmp(argv[i], "--min-radius") == 0)
+            target = &b.spawn.minRadius;
+        else if (strcmp(argv[i], "--max-radius") == 0)
+            target = &b.spawn.maxRadius;
+        else if (strcmp(argv[i], "--max-asteroids") == 0)
+            target = &b.pools.maxAsteroids;
+        else if (strcmp(argv[i], "--max-particles") == 0)
+            target = &b.pools.maxParticles;
+        else if (strcmp(argv[i], "--max-bullets") == 0)
+            target = &b.pools.maxBullets;
+
+        if (target != NULL && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], target))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            b.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--grow") == 0) {
+            b.pools.growable = 1;
+        } else if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+            if (!parseBroadphaseMode(argv[++i], &broadphaseMode))
+                return 1;
+        } else if (strcmp(argv[i], "--collision-solver") == 0 && i + 1 < argc) {
+            if (!parseCollisionSolver(argv[++i], &collisionSolver))
+                return 1;
+        } else if (strcmp(argv[i], "--particle-kernel") == 0 && i + 1 < argc) {
+            if (!parseParticleKernel(argv[++i], &particleKernel))
+                return 1;
+        } else if (strcmp(argv[i], "--results-csv") == 0 && i + 1 < argc) {
+            resultsCsv = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (b.spawn.minRadius > b.spawn.maxRadius || 2 * b.spawn.maxRadius >= HEIGHT) {
+        fprintf(stderr, "radius range must satisfy min <= max < %d\n", HEIGHT / 2);
+        return 1;
+    }
+    if (threads > BATCH_MAX_THREADS)
+        threads = BATCH_MAX_THREADS;
+    if (threads > worlds)
+        threads = worlds;
+    b.worldCount = worlds;
+    b.maxTicks = maxTicks;
+    b.pools.maxStars = 1;
+    particleKernel = resolveParticleKernel(particleKernel);
+
+    b.results = malloc(sizeof(WorldResult) * b.worldCount);
+    if (b.results == NULL) {
+        fprintf(stderr, "out of memory for %ld results\n", b.worldCount);
+        return 1;
+    }
+    atomic_init(&b.next, 0);
+
+    pthread_t pool[BATCH_MAX_THREADS];
+    double start = profNow();
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&pool[t], NULL, batchWorker, &b) != 0) {
+            fprintf(stderr, "cannot start worker thread %d\n", t);
+            return 1;
+        }
+    }
+    for (int t = 0; t < threads; t++)
+        pthread_join(pool[t], NULL);
+    double elapsed = profNow() - start;
+
+    printReport(&b, threads, elapsed);
+    if (resultsCsv != NULL && !writeResultsCsv(&b, resultsCsv)) {
+        fprintf(stderr, "cannot write results CSV: %s\n", resultsCsv);
+        return 1;
+    }
+
+    free(b.results);
+    return 0;
+}
@@ -0,0 +1,303 @@
+#include "game.h"
+#include "profiler.h"
+#include "raylib.h"
+#include "raymath.h"
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// CONSTANTS
+#define BENCH_DEFAULT_TICKS 1000
+#define BENCH_DEFAULT_SEED 1
+#define BENCH_DT (1.0f / 60.0f)
+
+// TYPES
+// Scenario setup runs once, prepare runs untimed before every tick, and only
+// tick is measured.
+typedef struct {
+    const char *name;
+    const char *description;
+    int defaultN;
+    void (*setup)(World *w, int n);
+    void (*prepare)(World *w, int n);
+    void (*tick)(World *w, int n);
+} Scenario;
+
+// HELPERS
+Vector2 randomPoint(World *w, float margin) {
+    Rng *r = &w->rng[RNG_SPAWN];
+    return (Vector2){(float)rngRange(r, (int)margin, (int)(WIDTH - margin)),
+                     (float)rngRange(r, (int)margin, (int)(HEIGHT - margin))};
+}
+
+// Reallocates the world with the given pools but keeps its RNG streams, so the
+// scenario still runs from the seed it was given.
+void resetWorld(World *w, PoolConfig pools) {
+    Rng rng[RNG_STREAM_COUNT];
+    memcpy(rng, w->rng, sizeof(rng));
+    freeWorld(w);
+    initWorld(w, pools, DEFAULT_SPAWN_CONFIG);
+    memcpy(w->rng, rng, sizeof(rng));
+}
+
+void noPrepare(World *w, int n) {
+    (void)w;
+    (void)n;
+}
+
+// DENSE FIELD: n small asteroids packed into the screen, colliding constantly.
+void denseFieldSetup(World *w, int n) {
+    resetWorld(w, (PoolConfig){n, 4096, 1, 1, 1});
+    for (int i = 0; i < n; i++) {
+        float r = (float)rngRange(&w->rng[RNG_SPAWN], 6, 12);
+        createAsteroid(w, randomPoint(w, r), r, getRandV(&w->rng[RNG_SPAWN]));
+    }
+}
+
+void denseFieldTick(World *w, int n) {
+    (void)n;
+    int score = 0;
+    clearEvents(w);
+    UpdateAsteroids(w, BENCH_DT);
+    checkCollisions(w);
+    applyEvents(w, &score);
+    updateParticles(w, BENCH_DT);
+}
+
+// SPLIT CASCADE: n big asteroids split down to dust in one tick.
+void splitCascadeSetup(World *w, int n) { resetWorld(w, (PoolConfig){n * 10, 4096, 1, 1, 1}); }
+
+void splitCascadePrepare(World *w, int n) {
+    w->asteroids.count = 0;
+    initParticles(w);
+    for (int i = 0; i < n; i++)
+        createAsteroid(w, randomPoint(w, R_BIG), R_BIG + 10.0f, getRandV(&w->rng[RNG_SPAWN]));
+}
+
+void splitCascadeTick(World *w, int n) {
+    (void)n;
+    while (w->asteroids.count > 0)
+        splitAsteroid(w, 0);
+}
+
+// PARTICLE STORM: n new particles every tick on top of a steady-state cloud.
+void particleStormSetup(World *w, int n) { resetWorld(w, (PoolConfig){1, n * 64, 1, 1, 1}); }
+
+void particleStormTick(World *w, int n) {
+    Vector2 center = {WIDTH / 2.0f, HEIGHT / 2.0f};
+    for (int i = 0; i < n; i++) {
+        Vector2 vel = Vector2Scale(getRandV(&w->rng[RNG_DEBRIS]), 3.0f);
+        createParticle(w, center, vel, (Color){255, 150, 50, 255}, 1.0f, 4.0f, PARTICLE_DEBRIS);
+    }
+    updateParticles(w, BENCH_DT);
+}
+
+// BULLET BARRAGE: n bullets in flight against a field of n / 2 asteroids that
+// is topped up between ticks.
+void bulletBarrageSetup(World *w, int n) { resetWorld(w, (PoolConfig){n, 4096, n, 1, 1}); }
+
+void bulletBarragePrepare(World *w, int n) {
+    while (w->asteroids.count < n / 2) {
+        float r = (float)rngRange(&w->rng[RNG_SPAWN], (int)R_SMALL, (int)R_BIG);
+        createAsteroid(w, randomPoint(w, r), r, getRandV(&w->rng[RNG_SPAWN]));
+    }
+    initParticles(w);
+}
+
+void bulletBarrageTick(World *w, int n) {
+    int score = 0;
+    int live = 0;
+    clearEvents(w);
+    for (int i = 0; i < w->bulletCapacity; i++)
+        live += w->bulletActive[i];
+    for (int i = live; i < n; i++) {
+        Vector2 pos = {0.0f, (float)rngRange(&w->rng[RNG_SPAWN], 0, HEIGHT)};
+        createBullet(w, pos, (Vector2){1, 0});
+    }
+
+    moveBullet(w, BENCH_DT);
+    handleBulletAsteroidCollisions(w);
+    updateBullets(w);
+    applyEvents(w, &score);
+}
+
+// SNAPSHOT ROUNDTRIP: save and restore a default-sized world that has been
+// played for n ticks. The buffer is kept across runs and freed by main().
+static void *snapshotBuf;
+static size_t snapshotBufSize;
+
+void snapshotSetup(World *w, int n) {
+    resetWorld(w, DEFAULT_POOL_CONFIG);
+    initGame(w);
+    Input in = {0};
+    in.shoot = 1;
+    for (int t = 0; t < n; t++) {
+        in.restart = w->game.gameOver || checkWin(w);
+        updateGame(w, in, BENCH_DT);
+    }
+
+    snapshotBufSize = snapshotSize(w) * 2;
+    snapshotBuf = resizeArray(snapshotBuf, (int)snapshotBufSize, 1);
+}
+
+void snapshotTick(World *w, int n) {
+    (void)n;
+    size_t size = saveSnapshot(w, snapshotBuf, snapshotBufSize);
+    restoreSnapshot(w, snapshotBuf, size);
+}
+
+const Scenario SCENARIOS[] = {
+    {"dense-field", "UpdateAsteroids + checkCollisions + applyEvents over n small asteroids", 2000,
+     denseFieldSetup, noPrepare, denseFieldTick},
+    {"split-cascade", "splitAsteroid until n big asteroids are gone", 200, splitCascadeSetup,
+     splitCascadePrepare, splitCascadeTick},
+    {"particle-storm", "n createParticle calls + updateParticles", 2000, particleStormSetup,
+     noPrepare, particleStormTick},
+    {"bullet-barrage", "handleBulletAsteroidCollisions + applyEvents with n bullets", 1000,
+     bulletBarrageSetup, bulletBarragePrepare, bulletBarrageTick},
+    {"snapshot-roundtrip", "saveSnapshot + restoreSnapshot after n ticks of play", 600,
+     snapshotSetup, noPrepare, snapshotTick},
+};
+const int SCENARIO_COUNT = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+// RUNNER
+int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Prints one JSON object per scenario so runs can be diffed or collected.
+void runScenario(const Scenario *s, int n, long ticks, unsigned int seed) {
+    World world;
+    memset(&world, 0, sizeof(world));
+    seedWorld(&world, seed);
+    s->setup(&world, n);
+
+    long warmup = ticks / 10;
+    for (long t = 0; t < warmup; t++) {
+        s->prepare(&world, n);
+        s->tick(&world, n);
+    }
+
+    double *samples = malloc(sizeof(double) * ticks);
+    double total = 0.0;
+    for (long t = 0; t < ticks; t++) {
+        s->prepare(&world, n);
+        double start = profNow();
+        s->tick(&world, n);
+        samples[t] = (profNow() - start) * 1e9;
+        total += samples[t];
+    }
+    qsort(samples, ticks, sizeof(double), compareDoubles);
+
+    printf("{\"scenario\":\"%s\",\"n\":%d,\"seed\":%u,\"ticks\":%ld,\"broadphase\":\"%s\","
+           "\"collision_solver\":\"%s\",\"particle_kernel\":\"%s\",\"jobs\":%d,"
+           "\"ns_per_tick\":%.1f,\"ticks_per_sec\":%.1f,\"p50_ns\":%.1f,"
+           "\"p99_ns\":%.1f,\"max_ns\":%.1f}\n",
+           s->name, n, seed, ticks, broadphaseName(broadphaseMode),
+           collisionSolverName(collisionSolver), particleKernelName(particleKernel),
+           jobSystem != NULL ? jobSystem->workerCount : 0, total / ticks, ticks * 1e9 / total,
+           samples[(ticks - 1) / 2], samples[(ticks - 1) * 99 / 100], samples[ticks - 1]);
+    fflush(stdout);
+    free(samples);
+    freeWorld(&world);
+}
+
+// MAIN ENTRY POINT
+void printUsage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--scenario NAME|all] [--n N] [--ticks N] [--seed S]\n"
+            "       [--broadphase brute|grid|sap|all] [--particle-kernel auto|scalar|sse2|avx2]\n"
+            "       [--collision-solver sequential|colored] [--jobs N] [--jobs-deterministic]\n"
+            "scenarios:\n",
+            prog);
+    for (int i = 0; i < SCENARIO_COUNT; i++)
+        fprintf(stderr, "  %-16s %s (default n=%d)\n", SCENARIOS[i].name,
+                SCENARIOS[i].description, SCENARIOS[i].defaultN);
+}
+
+int main(int argc, char **argv) {
+    const char *scenario = "all";
+    int n = 0;
+    long ticks = BENCH_DEFAULT_TICKS;
+    unsigned int seed = BENCH_DEFAULT_SEED;
+    int allBroadphases = 0;
+    int jobWorkers = 0;
+    int jobsDeterministic = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            scenario = argv[++i];
+        } else if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+            n = (int)strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+            if (strcmp(argv[++i], "all") == 0)
+                allBroadphases = 1;
+            else if (!parseBroadphaseMode(argv[i], &broadphaseMode))
+                return 1;
+        } else if (strcmp(argv[i], "--particle-kernel") == 0 && i + 1 < argc) {
+            if (!parseParticleKernel(argv[++i], &particleKernel))
+                return 1;
+        } else if (strcmp(argv[i], "--collision-solver") == 0 && i + 1 < argc) {
+            if (!parseCollisionSolver(argv[++i], &collisionSolver))
+                return 1;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            if (!parsePositive(argv[i], argv[i + 1], &jobWorkers))
+                return 1;
+            i++;
+        } else if (strcmp(argv[i], "--jobs-deterministic") == 0) {
+            jobsDeterministic = 1;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (ticks <= 0 || n < 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    particleKernel = resolveParticleKernel(particleKernel);
+
+    JobSystem jobs;
+    if (jobWorkers > 0) {
+        if (!jobsInit(&jobs, jobWorkers, jobsDeterministic)) {
+            fprintf(stderr, "cannot start %d job workers\n", jobWorkers);
+            return 1;
+        }
+        jobSystem = &jobs;
+    }
+
+    int ran = 0;
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        if (strcmp(scenario, "all") != 0 && strcmp(scenario, SCENARIOS[i].name) != 0)
+            continue;
+        int scenarioN = n > 0 ? n : SCENARIOS[i].defaultN;
+        if (allBroadphases) {
+            for (BroadphaseMode m = BROADPHASE_BRUTE; m <= BROADPHASE_SAP; m++) {
+                broadphaseMode = m;
+                runScenario(&SCENARIOS[i], scenarioN, ticks, seed);
+            }
+        } else {
+            runScenario(&SCENARIOS[i], scenarioN, ticks, seed);
+        }
+        ran++;
+    }
+    if (jobSystem != NULL)
+        jobsShutdown(jobSystem);
+    free(snapshotBuf);
+
+    if (ran == 0) {
+        fprintf(stderr, "unknown scenario: %s\n", scenario);
+        printUsage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
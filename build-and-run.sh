@@ -1,4 +1,4 @@
 #!/bin/sh
 mkdir -p bin
-cc -Wall -Wextra -g asteroid.c $(pkg-config --libs --cflags raylib) -o bin/asteroid
+cc -Wall -Wextra -O3 -g -pthread asteroid.c frame.c game.c input.c jobs.c profiler.c rng.c replay.c snapshot.c $(pkg-config --libs --cflags raylib) -o bin/asteroid
 ./bin/asteroid
\ No newline at end of file
@@ -2,4 +2,6 @@
 set -eu
 
 mkdir -p bin
-cc -Wall -Wextra -g asteroid.c $(pkg-config --libs --cflags raylib) -o bin/asteroid
+cc -Wall -Wextra -O3 -g -pthread asteroid.c frame.c game.c input.c jobs.c profiler.c rng.c replay.c snapshot.c $(pkg-config --libs --cflags raylib) -o bin/asteroid
+cc -Wall -Wextra -O3 -g -pthread bench.c game.c jobs.c profiler.c rng.c snapshot.c $(pkg-config --libs --cflags raylib) -o bin/asteroid-bench
+cc -Wall -Wextra -O3 -g -pthread batch.c game.c jobs.c profiler.c rng.c $(pkg-config --libs --cflags raylib) -o bin/asteroid-batch
@@ -0,0 +1,154 @@
+#include "frame.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Set on the middle index while its frame has not been picked up yet.
+#define FRAME_FRESH 4
+#define FRAME_INDEX 3
+
+static void reserveAsteroidFrame(AsteroidFrame *af, int capacity) {
+    if (af->capacity >= capacity)
+        return;
+    af->prevX = resizeArray(af->prevX, capacity, sizeof(float));
+    af->prevY = resizeArray(af->prevY, capacity, sizeof(float));
+    af->posX = resizeArray(af->posX, capacity, sizeof(float));
+    af->posY = resizeArray(af->posY, capacity, sizeof(float));
+    af->prevRotation = resizeArray(af->prevRotation, capacity, sizeof(float));
+    af->rotation = resizeArray(af->rotation, capacity, sizeof(float));
+    af->radius = resizeArray(af->radius, capacity, sizeof(float));
+    af->sides = resizeArray(af->sides, capacity, sizeof(int));
+    af->color = resizeArray(af->color, capacity, sizeof(Color));
+    af->capacity = capacity;
+}
+
+static void reserveParticleFrame(ParticleFrame *pf, int capacity) {
+    if (pf->capacity >= capacity)
+        return;
+    pf->prevX = resizeArray(pf->prevX, capacity, sizeof(float));
+    pf->prevY = resizeArray(pf->prevY, capacity, sizeof(float));
+    pf->posX = resizeArray(pf->posX, capacity, sizeof(float));
+    pf->posY = resizeArray(pf->posY, capacity, sizeof(float));
+    pf->fade = resizeArray(pf->fade, capacity, sizeof(float));
+    pf->size = resizeArray(pf->size, capacity, sizeof(float));
+    pf->color = resizeArray(pf->color, capacity, sizeof(Color));
+    pf->capacity = capacity;
+}
+
+static void captureAsteroids(AsteroidFrame *af, const AsteroidStore *as) {
+    size_t n = (size_t)as->count;
+    reserveAsteroidFrame(af, as->capacity);
+    memcpy(af->prevX, as->prevX, sizeof(float) * n);
+    memcpy(af->prevY, as->prevY, sizeof(float) * n);
+    memcpy(af->posX, as->posX, sizeof(float) * n);
+    memcpy(af->posY, as->posY, sizeof(float) * n);
+    memcpy(af->prevRotation, as->prevRotation, sizeof(float) * n);
+    memcpy(af->rotation, as->rotation, sizeof(float) * n);
+    memcpy(af->radius, as->radius, sizeof(float) * n);
+    memcpy(af->sides, as->sides, sizeof(int) * n);
+    for (int i = 0; i < as->count; i++) {
+        Color color = RAYWHITE;
+        if (as->hits[i] >= as->maxHits[i] - 1) {
+            color = (Color){255, 150, 150, 255};
+        } else if (as->hits[i] > 0) {
+            color = (Color){255, 200, 200, 255};
+        }
+        af->color[i] = color;
+    }
+    af->count = as->count;
+}
+
+static void captureParticles(ParticleFrame *pf, const ParticleStore *ps) {
+    size_t n = (size_t)ps->count;
+    reserveParticleFrame(pf, ps->capacity);
+    memcpy(pf->prevX, ps->prevX, sizeof(float) * n);
+    memcpy(pf->prevY, ps->prevY, sizeof(float) * n);
+    memcpy(pf->posX, ps->posX, sizeof(float) * n);
+    memcpy(pf->posY, ps->posY, sizeof(float) * n);
+    memcpy(pf->fade, ps->fade, sizeof(float) * n);
+    memcpy(pf->size, ps->size, sizeof(float) * n);
+    memcpy(pf->color, ps->color, sizeof(Color) * n);
+    pf->count = ps->count;
+}
+
+// Copies what drawing needs out of w. Buffers only grow, so once they have
+// caught up with the pools a capture allocates nothing.
+void captureFrame(RenderFrame *f, const World *w, double tickTime) {
+    captureAsteroids(&f->asteroids, &w->asteroids);
+    captureParticles(&f->particles, &w->particles);
+
+    if (f->bulletCapacity < w->bulletCapacity) {
+        f->bullets = resizeArray(f->bullets, w->bulletCapacity, sizeof(Bullet));
+        f->bulletCapacity = w->bulletCapacity;
+    }
+    f->bulletCount = 0;
+    for (int i = 0; i < w->bulletCapacity; i++) {
+        if (w->bulletActive[i])
+            f->bullets[f->bulletCount++] = w->bullets[i];
+    }
+
+    if (f->starCapacity < w->starCount) {
+        f->stars = resizeArray(f->stars, w->starCount, sizeof(Star));
+        f->starCapacity = w->starCount;
+    }
+    memcpy(f->stars, w->stars, sizeof(Star) * (size_t)w->starCount);
+    f->starCount = w->starCount;
+
+    f->ship = w->game.ship;
+    f->score = w->game.score;
+    f->gameOver = w->game.gameOver;
+    f->won = checkWin(w);
+    f->tickTime = tickTime;
+}
+
+void freeFrame(RenderFrame *f) {
+    AsteroidFrame *af = &f->asteroids;
+    free(af->prevX);
+    free(af->prevY);
+    free(af->posX);
+    free(af->posY);
+    free(af->prevRotation);
+    free(af->rotation);
+    free(af->radius);
+    free(af->sides);
+    free(af->color);
+
+    ParticleFrame *pf = &f->particles;
+    free(pf->prevX);
+    free(pf->prevY);
+    free(pf->posX);
+    free(pf->posY);
+    free(pf->fade);
+    free(pf->size);
+    free(pf->color);
+
+    free(f->bullets);
+    free(f->stars);
+    memset(f, 0, sizeof(*f));
+}
+
+void initFrameBuffer(FrameBuffer *fb) {
+    memset(fb, 0, sizeof(*fb));
+    fb->front = 0;
+    atomic_init(&fb->middle, 1);
+    fb->back = 2;
+}
+
+void freeFrameBuffer(FrameBuffer *fb) {
+    for (int i = 0; i < 3; i++)
+        freeFrame(&fb->frames[i]);
+}
+
+void publishFrame(FrameBuffer *fb, const World *w, double tickTime) {
+    captureFrame(&fb->frames[fb->back], w, tickTime);
+    int old = atomic_exchange_explicit(&fb->middle, fb->back | FRAME_FRESH, memory_order_acq_rel);
+    fb->back = old & FRAME_INDEX;
+}
+
+const RenderFrame *acquireFrame(FrameBuffer *fb) {
+    if (atomic_load_explicit(&fb->middle, memory_order_relaxed) & FRAME_FRESH) {
+        int old = atomic_exchange_explicit(&fb->middle, fb->front, memory_order_acq_rel);
+        fb->front = old & FRAME_INDEX;
+    }
+    return &fb->frames[fb->front];
+}
@@ -0,0 +1,73 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "game.h"
+
+#include <stdatomic.h>
+
+// Everything the renderer reads from one tick, copied out of the world so it
+// can be drawn while the next tick runs. Positions are kept for this tick and
+// the previous one so drawing can interpolate, and asteroid colours are
+// resolved from their hit counts at capture time.
+typedef struct {
+    float *prevX, *prevY;
+    float *posX, *posY;
+    float *prevRotation, *rotation;
+    float *radius;
+    int *sides;
+    Color *color;
+    int count;
+    int capacity;
+} AsteroidFrame;
+
+typedef struct {
+    float *prevX, *prevY;
+    float *posX, *posY;
+    float *fade;
+    float *size;
+    Color *color;
+    int count;
+    int capacity;
+} ParticleFrame;
+
+typedef struct {
+    AsteroidFrame asteroids;
+    ParticleFrame particles;
+    Bullet *bullets;
+    int bulletCount;
+    int bulletCapacity;
+    Star *stars;
+    int starCount;
+    int starCapacity;
+    Spaceship ship;
+    int score;
+    int gameOver;
+    int won;
+    double tickTime;
+} RenderFrame;
+
+// Lock-free triple buffer between one writer and one reader. The writer fills
+// its back frame and swaps it with the shared middle one; the reader swaps its
+// front frame for the middle one whenever a newer frame is waiting there.
+// Neither side ever waits for the other, and the reader always gets the latest
+// complete frame.
+typedef struct {
+    RenderFrame frames[3];
+    atomic_int middle;
+    int back;
+    int front;
+} FrameBuffer;
+
+void captureFrame(RenderFrame *f, const World *w, double tickTime);
+void freeFrame(RenderFrame *f);
+
+void initFrameBuffer(FrameBuffer *fb);
+void freeFrameBuffer(FrameBuffer *fb);
+
+// Writer side: captures w into the back frame and makes it the newest.
+void publishFrame(FrameBuffer *fb, const World *w, double tickTime);
+// Reader side: the newest published frame. It stays valid and unchanged until
+// the next call.
+const RenderFrame *acquireFrame(FrameBuffer *fb);
+
+#endif
@@ -0,0 +1,1791 @@
+#include "game.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// GLOBAL STATE
+// Only read-only configuration, the frontend profiler and the optional job
+// system live here; all simulation state is in World, so worlds can run side
+// by side on threads.
+const char *const PHASE_NAMES[PHASE_COUNT] = {
+    "update_stars",
+    "update_asteroids",
+    "update_ship",
+    "collisions",
+    "update_particles",
+    "shoot",
+    "apply_events",
+    "game_over",
+    "draw_stars",
+    "draw_particles",
+    "draw_asteroids",
+    "draw_hud",
+    "present",
+    "frame",
+};
+Profiler PROFILER;
+
+BroadphaseMode broadphaseMode = BROADPHASE_GRID;
+ParticleKernel particleKernel = PARTICLE_KERNEL_AUTO;
+CollisionSolver collisionSolver = SOLVER_SEQUENTIAL;
+JobSystem *jobSystem = NULL;
+
+// POOLS
+void *resizeArray(void *p, int count, size_t elemSize) {
+    void *q = realloc(p, (size_t)count * elemSize);
+    if (q == NULL && count > 0) {
+        fprintf(stderr, "out of memory resizing pool to %d entries\n", count);
+        exit(1);
+    }
+    return q;
+}
+
+void reserveAsteroids(World *w, int capacity) {
+    AsteroidStore *as = &w->asteroids;
+    as->posX = resizeArray(as->posX, capacity, sizeof(float));
+    as->posY = resizeArray(as->posY, capacity, sizeof(float));
+    as->velX = resizeArray(as->velX, capacity, sizeof(float));
+    as->velY = resizeArray(as->velY, capacity, sizeof(float));
+    as->prevX = resizeArray(as->prevX, capacity, sizeof(float));
+    as->prevY = resizeArray(as->prevY, capacity, sizeof(float));
+    as->radius = resizeArray(as->radius, capacity, sizeof(float));
+    as->mass = resizeArray(as->mass, capacity, sizeof(float));
+    as->rotation = resizeArray(as->rotation, capacity, sizeof(float));
+    as->prevRotation = resizeArray(as->prevRotation, capacity, sizeof(float));
+    as->sides = resizeArray(as->sides, capacity, sizeof(int));
+    as->hits = resizeArray(as->hits, capacity, sizeof(int));
+    as->maxHits = resizeArray(as->maxHits, capacity, sizeof(int));
+    as->size = resizeArray(as->size, capacity, sizeof(AsteroidSize));
+    as->capacity = capacity;
+}
+
+void reserveParticles(World *w, int capacity) {
+    ParticleStore *ps = &w->particles;
+    ps->posX = resizeArray(ps->posX, capacity, sizeof(float));
+    ps->posY = resizeArray(ps->posY, capacity, sizeof(float));
+    ps->velX = resizeArray(ps->velX, capacity, sizeof(float));
+    ps->velY = resizeArray(ps->velY, capacity, sizeof(float));
+    ps->prevX = resizeArray(ps->prevX, capacity, sizeof(float));
+    ps->prevY = resizeArray(ps->prevY, capacity, sizeof(float));
+    ps->lifetime = resizeArray(ps->lifetime, capacity, sizeof(float));
+    ps->invMaxLifetime = resizeArray(ps->invMaxLifetime, capacity, sizeof(float));
+    ps->fade = resizeArray(ps->fade, capacity, sizeof(float));
+    ps->size = resizeArray(ps->size, capacity, sizeof(float));
+    ps->color = resizeArray(ps->color, capacity, sizeof(Color));
+    ps->priority = resizeArray(ps->priority, capacity, sizeof(uint8_t));
+    ps->victims = resizeArray(ps->victims, capacity, sizeof(int));
+    ps->deadMask = resizeArray(ps->deadMask, (capacity + 31) / 32, sizeof(uint32_t));
+    ps->capacity = capacity;
+}
+
+// New slots are pushed in reverse so the lowest index is handed out first.
+void reserveBullets(World *w, int capacity) {
+    int old = w->bulletCapacity;
+    w->bullets = resizeArray(w->bullets, capacity, sizeof(Bullet));
+    w->bulletActive = resizeArray(w->bulletActive, capacity, sizeof(int));
+    w->bulletFree = resizeArray(w->bulletFree, capacity, sizeof(int));
+    for (int i = capacity - 1; i >= old; i--) {
+        w->bulletActive[i] = 0;
+        w->bulletFree[w->bulletFreeCount++] = i;
+    }
+    w->bulletCapacity = capacity;
+}
+
+int growPool(World *w, int *capacity, void (*reserve)(World *, int)) {
+    if (!w->pools.growable)
+        return 0;
+    reserve(w, *capacity * 2);
+    w->poolStats.growths++;
+    return 1;
+}
+
+// WORLD
+// Allocates the pools for a fresh world. The world stays empty until it is
+// seeded and initGame() spawns the first round.
+void initWorld(World *w, PoolConfig pools, SpawnConfig spawn) {
+    memset(w, 0, sizeof(*w));
+    w->pools = pools;
+    w->spawn = spawn;
+    reserveAsteroids(w, pools.maxAsteroids);
+    reserveParticles(w, pools.maxParticles);
+    reserveBullets(w, pools.maxBullets);
+    w->stars = resizeArray(NULL, pools.maxStars, sizeof(Star));
+    w->starCount = pools.maxStars;
+    w->grid.dirty = 1;
+    w->sap.stale = 1;
+}
+
+void freeWorld(World *w) {
+    AsteroidStore *as = &w->asteroids;
+    free(as->posX);
+    free(as->posY);
+    free(as->velX);
+    free(as->velY);
+    free(as->prevX);
+    free(as->prevY);
+    free(as->radius);
+    free(as->mass);
+    free(as->rotation);
+    free(as->prevRotation);
+    free(as->sides);
+    free(as->hits);
+    free(as->maxHits);
+    free(as->size);
+
+    ParticleStore *ps = &w->particles;
+    free(ps->posX);
+    free(ps->posY);
+    free(ps->velX);
+    free(ps->velY);
+    free(ps->prevX);
+    free(ps->prevY);
+    free(ps->lifetime);
+    free(ps->invMaxLifetime);
+    free(ps->fade);
+    free(ps->size);
+    free(ps->color);
+    free(ps->priority);
+    free(ps->victims);
+    free(ps->deadMask);
+
+    free(w->bullets);
+    free(w->bulletActive);
+    free(w->bulletFree);
+    free(w->stars);
+    free(w->grid.cellItems);
+    free(w->grid.itemCell);
+    free(w->grid.queryItems);
+    free(w->grid.pairs.items);
+    free(w->sap.entries);
+    free(w->sap.bucketStart);
+    free(w->sap.found.items);
+    free(w->sap.pairs.items);
+    free(w->corrections.moved);
+    free(w->corrections.loose);
+    free(w->corrections.startX);
+    free(w->corrections.startY);
+    free(w->coloring.contacts.items);
+    free(w->coloring.pairStart);
+    free(w->coloring.usedColors);
+    free(w->coloring.batched);
+    free(w->coloring.bounced);
+    free(w->coloring.points);
+    free(w->events.items);
+    memset(w, 0, sizeof(*w));
+}
+
+void seedWorld(World *w, uint64_t seed) {
+    for (int s = 0; s < RNG_STREAM_COUNT; s++)
+        rngSeed(&w->rng[s], seed, (uint64_t)s);
+}
+
+// STARS
+void initStars(World *w) {
+    Rng *r = &w->rng[RNG_STARS];
+    for (int i = 0; i < w->starCount; i++) {
+        w->stars[i].pos = (Vector2){(float)rngRange(r, 0, WIDTH), (float)rngRange(r, 0, HEIGHT)};
+        w->stars[i].brightness = (float)rngRange(r, 50, 150) / 255.0f;
+        w->stars[i].phase = (float)rngRange(r, 0, 360);
+    }
+}
+
+int updateStarRange(void *ctx, int begin, int end) {
+    StarJob *job = ctx;
+    for (int i = begin; i < end; i++) {
+        job->stars[i].phase += 0.02f * job->step;
+    }
+    return 0;
+}
+
+void updateStars(World *w, float dt) {
+    StarJob job = {w->stars, dt * BASE_HZ};
+    parallelFor(jobSystem, w->starCount, JOB_GRAIN, updateStarRange, &job);
+}
+
+// PARTICLES
+const Color SPARK_COLORS[] = {{255, 200, 100, 255}};
+const BurstStyle SPARK_BURST = {1.5f, 1.5f, SPARK_COLORS, 1, 0.5f, 2.0f, PARTICLE_SPARK};
+
+const Color DEBRIS_COLORS[] = {{255, 150, 50, 255}, {255, 100, 30, 255}};
+const BurstStyle DEBRIS_BURST = {3.0f, 3.0f, DEBRIS_COLORS, 2, 1.0f, 4.0f, PARTICLE_DEBRIS};
+
+void initParticles(World *w) { w->particles.count = 0; }
+
+void moveParticle(ParticleStore *ps, int to, int from) {
+    ps->posX[to] = ps->posX[from];
+    ps->posY[to] = ps->posY[from];
+    ps->velX[to] = ps->velX[from];
+    ps->velY[to] = ps->velY[from];
+    ps->prevX[to] = ps->prevX[from];
+    ps->prevY[to] = ps->prevY[from];
+    ps->lifetime[to] = ps->lifetime[from];
+    ps->invMaxLifetime[to] = ps->invMaxLifetime[from];
+    ps->fade[to] = ps->fade[from];
+    ps->size[to] = ps->size[from];
+    ps->color[to] = ps->color[from];
+    ps->priority[to] = ps->priority[from];
+}
+
+// Whether particle i should be evicted before particle j.
+int evictsBefore(const ParticleStore *ps, int i, int j) {
+    if (ps->priority[i] != ps->priority[j])
+        return ps->priority[i] < ps->priority[j];
+    return ps->fade[i] < ps->fade[j];
+}
+
+void siftVictim(ParticleStore *ps, int n, int k) {
+    int *heap = ps->victims;
+    for (;;) {
+        int top = k;
+        int l = 2 * k + 1;
+        int r = l + 1;
+        if (l < n && evictsBefore(ps, heap[top], heap[l]))
+            top = l;
+        if (r < n && evictsBefore(ps, heap[top], heap[r]))
+            top = r;
+        if (top == k)
+            return;
+        int t = heap[k];
+        heap[k] = heap[top];
+        heap[top] = t;
+        k = top;
+    }
+}
+
+// Frees up to count slots at the tail by swap-removing the particles that
+// should go first among those ranked no higher than priority. The victims
+// are picked with a bounded heap whose root is the one that should go last,
+// then removed from the highest index down so no victim is moved before its
+// turn. Returns how many were evicted.
+int evictParticles(World *w, int count, ParticlePriority priority) {
+    ParticleStore *ps = &w->particles;
+    int *heap = ps->victims;
+    int n = 0;
+    for (int i = 0; i < ps->count && count > 0; i++) {
+        if (ps->priority[i] > priority)
+            continue;
+        if (n < count) {
+            heap[n++] = i;
+            for (int k = n / 2 - 1; n == count && k >= 0; k--)
+                siftVictim(ps, n, k);
+        } else if (evictsBefore(ps, i, heap[0])) {
+            heap[0] = i;
+            siftVictim(ps, n, 0);
+        }
+    }
+
+    for (int v = 1; v < n; v++) {
+        int key = heap[v];
+        int q = v - 1;
+        while (q >= 0 && heap[q] < key) {
+            heap[q + 1] = heap[q];
+            q--;
+        }
+        heap[q + 1] = key;
+    }
+    for (int v = 0; v < n; v++) {
+        int last = --ps->count;
+        if (heap[v] != last)
+            moveParticle(ps, heap[v], last);
+    }
+    w->poolStats.particleEvictions += n;
+    return n;
+}
+
+void createParticle(World *w, Vector2 pos, Vector2 vel, Color color, float lifetime, float size,
+                    ParticlePriority priority) {
+    ParticleStore *ps = &w->particles;
+    if (ps->count == ps->capacity && !growPool(w, &ps->capacity, reserveParticles) &&
+        evictParticles(w, 1, priority) == 0) {
+        w->poolStats.particleDrops++;
+        return;
+    }
+
+    int i = ps->count++;
+    ps->posX[i] = pos.x;
+    ps->posY[i] = pos.y;
+    ps->prevX[i] = pos.x;
+    ps->prevY[i] = pos.y;
+    ps->velX[i] = vel.x;
+    ps->velY[i] = vel.y;
+    ps->lifetime[i] = lifetime;
+    ps->invMaxLifetime[i] = 1.0f / lifetime;
+    ps->fade[i] = 1.0f;
+    ps->size[i] = size;
+    ps->color[i] = color;
+    ps->priority[i] = (uint8_t)priority;
+}
+
+// Reserves count slots at the tail in one go (growing the pool once if it
+// may) and fills them in straight loops: directions and speeds are drawn
+// first, then turned into velocities. Returns how many were emitted; the rest
+// count as drops.
+int emitBurst(World *w, Vector2 pos, int count, const BurstStyle *style) {
+    ParticleStore *ps = &w->particles;
+    while (ps->count + count > ps->capacity && growPool(w, &ps->capacity, reserveParticles))
+        ;
+    int room = ps->capacity - ps->count;
+    if (count > room)
+        room += evictParticles(w, count - room, style->priority);
+    if (count > room) {
+        w->poolStats.particleDrops += count - room;
+        count = room;
+    }
+
+    Rng *r = &w->rng[RNG_DEBRIS];
+    int first = ps->count;
+    int end = first + count;
+    for (int i = first; i < end; i++)
+        ps->velX[i] = rngFloat(r) * 2.0f * PI;
+    float speedSpan = style->maxSpeed - style->minSpeed;
+    for (int i = first; i < end; i++)
+        ps->velY[i] = style->minSpeed + (speedSpan > 0.0f ? rngFloat(r) * speedSpan : 0.0f);
+    for (int i = first; i < end; i++) {
+        int c = style->paletteSize > 1 ? rngRange(r, 0, style->paletteSize - 1) : 0;
+        ps->color[i] = style->palette[c];
+    }
+    for (int i = first; i < end; i++) {
+        float angle = ps->velX[i];
+        float speed = ps->velY[i];
+        ps->velX[i] = cosf(angle) * speed;
+        ps->velY[i] = sinf(angle) * speed;
+    }
+
+    float invLifetime = 1.0f / style->lifetime;
+    for (int i = first; i < end; i++) {
+        ps->posX[i] = pos.x;
+        ps->posY[i] = pos.y;
+        ps->prevX[i] = pos.x;
+        ps->prevY[i] = pos.y;
+        ps->lifetime[i] = style->lifetime;
+        ps->invMaxLifetime[i] = invLifetime;
+        ps->fade[i] = 1.0f;
+        ps->size[i] = style->size;
+        ps->priority[i] = (uint8_t)style->priority;
+    }
+    ps->count = end;
+    return count;
+}
+
+void markDeadParticles(ParticleStore *ps, int base, int lanes) {
+    while (lanes) {
+        int j = base + __builtin_ctz(lanes);
+        ps->deadMask[j >> 5] |= 1u << (j & 31);
+        lanes &= lanes - 1;
+    }
+}
+
+// Reference kernel. The SIMD kernels below perform exactly the same float
+// operations in the same order, so all three produce bit-identical results.
+int integrateParticlesScalar(ParticleStore *ps, int begin, int end, float step, float dt) {
+    int dead = 0;
+    for (int i = begin; i < end; i++) {
+        ps->prevX[i] = ps->posX[i];
+        ps->prevY[i] = ps->posY[i];
+        ps->posX[i] += ps->velX[i] * step;
+        ps->posY[i] += ps->velY[i] * step;
+
+        float life = ps->lifetime[i] - dt;
+        ps->lifetime[i] = life;
+        ps->fade[i] = life * ps->invMaxLifetime[i];
+
+        if (life <= 0.0f) {
+            markDeadParticles(ps, i, 1);
+            dead++;
+        }
+    }
+    return dead;
+}
+
+#if defined(__SSE2__)
+int integrateParticlesSSE2(ParticleStore *ps, int begin, int end, float step, float dt) {
+    __m128 vstep = _mm_set1_ps(step);
+    __m128 vdt = _mm_set1_ps(dt);
+    __m128 zero = _mm_setzero_ps();
+    int dead = 0;
+    int i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(ps->posX + i);
+        __m128 y = _mm_loadu_ps(ps->posY + i);
+        _mm_storeu_ps(ps->prevX + i, x);
+        _mm_storeu_ps(ps->prevY + i, y);
+        x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(ps->velX + i), vstep));
+        y = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(ps->velY + i), vstep));
+        _mm_storeu_ps(ps->posX + i, x);
+        _mm_storeu_ps(ps->posY + i, y);
+
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(ps->lifetime + i), vdt);
+        _mm_storeu_ps(ps->lifetime + i, life);
+        _mm_storeu_ps(ps->fade + i, _mm_mul_ps(life, _mm_loadu_ps(ps->invMaxLifetime + i)));
+
+        int lanes = _mm_movemask_ps(_mm_cmple_ps(life, zero));
+        if (lanes) {
+            markDeadParticles(ps, i, lanes);
+            dead += __builtin_popcount(lanes);
+        }
+    }
+    return dead + integrateParticlesScalar(ps, i, end, step, dt);
+}
+
+__attribute__((target("avx2"))) int integrateParticlesAVX2(ParticleStore *ps, int begin, int end,
+                                                           float step, float dt) {
+    __m256 vstep = _mm256_set1_ps(step);
+    __m256 vdt = _mm256_set1_ps(dt);
+    __m256 zero = _mm256_setzero_ps();
+    int dead = 0;
+    int i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(ps->posX + i);
+        __m256 y = _mm256_loadu_ps(ps->posY + i);
+        _mm256_storeu_ps(ps->prevX + i, x);
+        _mm256_storeu_ps(ps->prevY + i, y);
+        x = _mm256_add_ps(x, _mm256_mul_ps(_mm256_loadu_ps(ps->velX + i), vstep));
+        y = _mm256_add_ps(y, _mm256_mul_ps(_mm256_loadu_ps(ps->velY + i), vstep));
+        _mm256_storeu_ps(ps->posX + i, x);
+        _mm256_storeu_ps(ps->posY + i, y);
+
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(ps->lifetime + i), vdt);
+        _mm256_storeu_ps(ps->lifetime + i, life);
+        _mm256_storeu_ps(ps->fade + i,
+                         _mm256_mul_ps(life, _mm256_loadu_ps(ps->invMaxLifetime + i)));
+
+        int lanes = _mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_LE_OQ));
+        if (lanes) {
+            markDeadParticles(ps, i, lanes);
+            dead += __builtin_popcount(lanes);
+        }
+    }
+    return dead + integrateParticlesSSE2(ps, i, end, step, dt);
+}
+#endif
+
+// Resolves AUTO to the widest kernel this CPU supports and downgrades
+// requests the build or CPU can't honour.
+ParticleKernel resolveParticleKernel(ParticleKernel k) {
+#if defined(__SSE2__)
+    int hasAvx2 = __builtin_cpu_supports("avx2");
+    if (k == PARTICLE_KERNEL_AUTO)
+        return hasAvx2 ? PARTICLE_KERNEL_AVX2 : PARTICLE_KERNEL_SSE2;
+    if (k == PARTICLE_KERNEL_AVX2 && !hasAvx2)
+        return PARTICLE_KERNEL_SSE2;
+    return k;
+#else
+    (void)k;
+    return PARTICLE_KERNEL_SCALAR;
+#endif
+}
+
+const char *particleKernelName(ParticleKernel k) {
+    switch (k) {
+    case PARTICLE_KERNEL_AUTO:
+        return "auto";
+    case PARTICLE_KERNEL_SCALAR:
+        return "scalar";
+    case PARTICLE_KERNEL_SSE2:
+        return "sse2";
+    case PARTICLE_KERNEL_AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+int parseParticleKernel(const char *name, ParticleKernel *out) {
+    for (ParticleKernel k = PARTICLE_KERNEL_AUTO; k <= PARTICLE_KERNEL_AVX2; k++) {
+        if (strcmp(name, particleKernelName(k)) == 0) {
+            *out = k;
+            return 1;
+        }
+    }
+    fprintf(stderr, "unknown particle kernel: %s\n", name);
+    return 0;
+}
+
+int integrateParticles(ParticleStore *ps, int begin, int end, float step, float dt) {
+    switch (particleKernel) {
+#if defined(__SSE2__)
+    case PARTICLE_KERNEL_AVX2:
+        return integrateParticlesAVX2(ps, begin, end, step, dt);
+    case PARTICLE_KERNEL_SSE2:
+        return integrateParticlesSSE2(ps, begin, end, step, dt);
+#endif
+    default:
+        return integrateParticlesScalar(ps, begin, end, step, dt);
+    }
+}
+
+int isParticleDead(const ParticleStore *ps, int i) {
+    return (ps->deadMask[i >> 5] >> (i & 31)) & 1;
+}
+
+void compactParticles(ParticleStore *ps) {
+    int n = ps->count;
+    int i = 0;
+    while (i < n) {
+        if (!isParticleDead(ps, i)) {
+            i++;
+            continue;
+        }
+        n--;
+        while (n > i && isParticleDead(ps, n))
+            n--;
+        if (n > i)
+            moveParticle(ps, i, n);
+        i++;
+    }
+    ps->count = n;
+}
+
+int integrateParticleRange(void *ctx, int begin, int end) {
+    ParticleJob *job = ctx;
+    return integrateParticles(job->ps, begin, end, job->step, job->dt);
+}
+
+void updateParticles(World *w, float dt) {
+    ParticleStore *ps = &w->particles;
+    memset(ps->deadMask, 0, sizeof(uint32_t) * ((ps->count + 31) / 32));
+
+    ParticleJob job = {ps, dt * BASE_HZ, dt};
+    if (parallelFor(jobSystem, ps->count, JOB_GRAIN, integrateParticleRange, &job) > 0)
+        compactParticles(ps);
+}
+
+// HELPERS
+Vector2 getRandV(Rng *r) {
+    float angle = (float)rngRange(r, 0, 369) * DEG2RAD;
+    return (Vector2){cosf(angle), sinf(angle)};
+}
+
+AsteroidSize getAsteroidSize(float r) {
+    if (r >= R_BIG)
+        return AST_BIG;
+    if (r >= R_MED)
+        return AST_MED;
+    return AST_SMALL;
+}
+
+int maxHitsFromSize(AsteroidSize s) {
+    switch (s) {
+    case AST_SMALL:
+        return 1;
+    case AST_MED:
+        return 2;
+    case AST_BIG:
+        return 3;
+    }
+    return 1;
+}
+
+// Earliest time t in [0, 1] at which a point moving from start to end comes
+// within radius of the origin, or -1 if it never does.
+float sweptCircleTime(Vector2 start, Vector2 end, float radius) {
+    Vector2 d = Vector2Subtract(end, start);
+    float c = Vector2DotProduct(start, start) - radius * radius;
+    if (c <= 0.0f)
+        return 0.0f;
+
+    float a = Vector2DotProduct(d, d);
+    float b = Vector2DotProduct(start, d);
+    if (a <= 0.0f || b >= 0.0f)
+        return -1.0f;
+
+    float disc = b * b - a * c;
+    if (disc < 0.0f)
+        return -1.0f;
+
+    float t = (-b - sqrtf(disc)) / a;
+    return t <= 1.0f ? t : -1.0f;
+}
+
+int parsePositive(const char *flag, const char *value, int *out) {
+    long v = strtol(value, NULL, 10);
+    if (v <= 0 || v > 1 << 28) {
+        fprintf(stderr, "%s must be a positive count\n", flag);
+        return 0;
+    }
+    *out = (int)v;
+    return 1;
+}
+
+// ASTEROIDS
+int createAsteroid(World *w, Vector2 pos, float r, Vector2 velDir) {
+    AsteroidStore *as = &w->asteroids;
+    if (as->count == as->capacity && !growPool(w, &as->capacity, reserveAsteroids)) {
+        w->poolStats.asteroidDrops++;
+        return -1;
+    }
+
+    int sides = rngRange(&w->rng[RNG_SPAWN], ASTEROID_MIN_SIDES, ASTEROID_MAX_SIDES);
+    float rotation = (float)rngRange(&w->rng[RNG_SPAWN], 1, 5);
+
+    AsteroidSize s = getAsteroidSize(r);
+    Vector2 vel = Vector2Normalize(velDir);
+
+    int i = as->count++;
+    as->posX[i] = pos.x;
+    as->posY[i] = pos.y;
+    as->velX[i] = vel.x;
+    as->velY[i] = vel.y;
+    as->prevX[i] = pos.x;
+    as->prevY[i] = pos.y;
+    as->radius[i] = r;
+    as->mass[i] = r * r;
+    as->rotation[i] = rotation;
+    as->prevRotation[i] = rotation;
+    as->sides[i] = sides;
+
+    as->hits[i] = 0;
+    as->size[i] = s;
+    as->maxHits[i] = maxHitsFromSize(s);
+    w->grid.dirty = 1;
+    sapInsert(&w->sap, as, i);
+    return i;
+}
+
+void removeAsteroid(World *w, int i) {
+    AsteroidStore *as = &w->asteroids;
+    int last = --as->count;
+    w->grid.dirty = 1;
+    sapRemove(&w->sap, i, last);
+    if (i == last)
+        return;
+
+    as->posX[i] = as->posX[last];
+    as->posY[i] = as->posY[last];
+    as->velX[i] = as->velX[last];
+    as->velY[i] = as->velY[last];
+    as->prevX[i] = as->prevX[last];
+    as->prevY[i] = as->prevY[last];
+    as->radius[i] = as->radius[last];
+    as->mass[i] = as->mass[last];
+    as->rotation[i] = as->rotation[last];
+    as->prevRotation[i] = as->prevRotation[last];
+    as->sides[i] = as->sides[last];
+    as->hits[i] = as->hits[last];
+    as->maxHits[i] = as->maxHits[last];
+    as->size[i] = as->size[last];
+}
+
+void initAsteroids(World *w) {
+    Rng *r = &w->rng[RNG_SPAWN];
+    w->asteroids.count = 0;
+
+    for (int i = 0; i < w->spawn.startAsteroids; i++) {
+        float radius = (float)rngRange(r, w->spawn.minRadius, w->spawn.maxRadius);
+        Vector2 pos;
+        pos.x = (float)rngRange(r, (int)radius, (int)(WIDTH - radius));
+        pos.y = (float)rngRange(r, (int)radius, (int)(HEIGHT - radius));
+
+        if (createAsteroid(w, pos, radius, getRandV(r)) == -1)
+            break;
+    }
+}
+
+// Bounces asteroids ia and ib off each other if they overlap and are closing.
+// Only those two asteroids are touched, so contacts with no asteroid in
+// common can be resolved at the same time. Returns 1 and the contact point if
+// they bounced.
+int resolveContact(AsteroidStore *as, int ia, int ib, Vector2 *contact) {
+    Vector2 posA = {as->posX[ia], as->posY[ia]};
+    Vector2 posB = {as->posX[ib], as->posY[ib]};
+    float massA = as->mass[ia];
+    float massB = as->mass[ib];
+
+    Vector2 delta = Vector2Subtract(posA, posB);
+    float dsq = Vector2LengthSqr(delta);
+    float rsum = as->radius[ia] + as->radius[ib];
+
+    if (dsq <= 0.0000001f || dsq >= rsum * rsum)
+        return 0;
+
+    float dist = sqrtf(dsq);
+    Vector2 unitNormal = Vector2Scale(delta, 1.0f / dist);
+    Vector2 unitTangent = (Vector2){-unitNormal.y, unitNormal.x};
+
+    Vector2 velA = {as->velX[ia], as->velY[ia]};
+    Vector2 velB = {as->velX[ib], as->velY[ib]};
+    Vector2 rv = Vector2Subtract(velA, velB);
+    float velAlongNormal = Vector2DotProduct(rv, unitNormal);
+    if (velAlongNormal > 0.0f)
+        return 0;
+
+    float overlap = rsum - dist;
+    float invMa = (massA > 0) ? 1.0f / massA : 0.0f;
+    float invMb = (massB > 0) ? 1.0f / massB : 0.0f;
+    float invSum = invMa + invMb;
+    if (invSum > 0.0f) {
+        Vector2 correction = Vector2Scale(unitNormal, overlap / invSum);
+        posA = Vector2Add(posA, Vector2Scale(correction, invMa));
+        posB = Vector2Subtract(posB, Vector2Scale(correction, invMb));
+        as->posX[ia] = posA.x;
+        as->posY[ia] = posA.y;
+        as->posX[ib] = posB.x;
+        as->posY[ib] = posB.y;
+    }
+
+    float va_n = Vector2DotProduct(velA, unitNormal);
+    float va_t = Vector2DotProduct(velA, unitTangent);
+    float vb_n = Vector2DotProduct(velB, unitNormal);
+    float vb_t = Vector2DotProduct(velB, unitTangent);
+
+    float va_np = (va_n * (massA - massB) + 2.0f * massB * vb_n) / (massA + massB);
+    float vb_np = (vb_n * (massB - massA) + 2.0f * massA * va_n) / (massA + massB);
+
+    Vector2 va_np_vector = Vector2Scale(unitNormal, va_np);
+    Vector2 va_tp_vector = Vector2Scale(unitTangent, va_t);
+    Vector2 vb_np_vector = Vector2Scale(unitNormal, vb_np);
+    Vector2 vb_tp_vector = Vector2Scale(unitTangent, vb_t);
+
+    Vector2 velFinal_A = Vector2Add(va_np_vector, va_tp_vector);
+    Vector2 velFinal_B = Vector2Add(vb_np_vector, vb_tp_vector);
+
+    as->velX[ia] = velFinal_A.x;
+    as->velY[ia] = velFinal_A.y;
+    as->velX[ib] = velFinal_B.x;
+    as->velY[ib] = velFinal_B.y;
+
+    *contact = Vector2Add(posA, Vector2Scale(unitNormal, -as->radius[ia]));
+    return 1;
+}
+
+void resolveCollisions(World *w, int ia, int ib) {
+    Vector2 contact;
+    if (resolveContact(&w->asteroids, ia, ib, &contact)) {
+        w->grid.dirty = 1;
+        pushEvent(w, (Event){EVENT_CONTACT, ia, ib, contact, 0});
+    }
+}
+
+// BROADPHASE
+int gridCellCoord(float v, int n, float cellSize) {
+    int c = (int)floorf(v / cellSize);
+    if (c < 0)
+        return 0;
+    if (c >= n)
+        return n - 1;
+    return c;
+}
+
+// Bins live asteroids into a uniform grid whose cells are at least one max
+// diameter plus the contact margin wide, so every pair that is within the
+// margin of touching lies in the same or adjacent cells.
+void buildGrid(SpatialGrid *g, const AsteroidStore *as) {
+    float maxRadius = 0.0f;
+    float maxStep = 0.0f;
+    for (int i = 0; i < as->count; i++) {
+        maxRadius = fmaxf(maxRadius, as->radius[i]);
+        maxStep = fmaxf(maxStep, fabsf(as->posX[i] - as->prevX[i]) +
+                                     fabsf(as->posY[i] - as->prevY[i]));
+    }
+    g->maxRadius = maxRadius;
+    g->maxStep = maxStep;
+    g->margin = maxRadius;
+
+    g->cellSize = fmaxf(2.0f * maxRadius + g->margin, 1.0f);
+    g->cols = (int)ceilf(WIDTH / g->cellSize);
+    g->rows = (int)ceilf(HEIGHT / g->cellSize);
+    while (g->cols * g->rows > GRID_MAX_CELLS) {
+        g->cellSize *= 2.0f;
+        g->cols = (int)ceilf(WIDTH / g->cellSize);
+        g->rows = (int)ceilf(HEIGHT / g->cellSize);
+    }
+
+    if (g->itemCapacity < as->capacity) {
+        g->cellItems = resizeArray(g->cellItems, as->capacity, sizeof(int));
+        g->itemCell = resizeArray(g->itemCell, as->capacity, sizeof(int));
+        g->queryItems = resizeArray(g->queryItems, as->capacity, sizeof(int));
+        g->itemCapacity = as->capacity;
+    }
+
+    int cellCount = g->cols * g->rows;
+    memset(g->cellStart, 0, sizeof(int) * (cellCount + 1));
+
+    for (int i = 0; i < as->count; i++) {
+        int cx = gridCellCoord(as->posX[i], g->cols, g->cellSize);
+        int cy = gridCellCoord(as->posY[i], g->rows, g->cellSize);
+        g->itemCell[i] = cy * g->cols + cx;
+        g->cellStart[g->itemCell[i] + 1]++;
+    }
+
+    for (int c = 0; c < cellCount; c++)
+        g->cellStart[c + 1] += g->cellStart[c];
+
+    int fill[GRID_MAX_CELLS];
+    memcpy(fill, g->cellStart, sizeof(int) * cellCount);
+    for (int i = 0; i < as->count; i++)
+        g->cellItems[fill[g->itemCell[i]]++] = i;
+    g->dirty = 0;
+}
+
+// Collects into grid.queryItems every asteroid that could touch the circle
+// at either end of this tick: the search box is grown by the largest radius
+// and the largest move, so callers still run their exact test. Returns the
+// number of candidates.
+int queryAsteroids(World *w, Vector2 center, float radius) {
+    SpatialGrid *g = &w->grid;
+    if (g->dirty)
+        buildGrid(g, &w->asteroids);
+
+    float reach = radius + g->maxRadius + g->maxStep;
+    int cx0 = gridCellCoord(center.x - reach, g->cols, g->cellSize);
+    int cx1 = gridCellCoord(center.x + reach, g->cols, g->cellSize);
+    int cy0 = gridCellCoord(center.y - reach, g->rows, g->cellSize);
+    int cy1 = gridCellCoord(center.y + reach, g->rows, g->cellSize);
+
+    int count = 0;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            int c = cy * g->cols + cx;
+            for (int k = g->cellStart[c]; k < g->cellStart[c + 1]; k++)
+                g->queryItems[count++] = g->cellItems[k];
+        }
+    }
+    return count;
+}
+
+void pushPair(PairList *l, int a, int b) {
+    if (l->count == l->capacity) {
+        l->capacity = l->capacity ? l->capacity * 2 : GRID_MIN_PAIRS;
+        l->items = resizeArray(l->items, l->capacity, sizeof(CollisionPair));
+    }
+    l->items[l->count++] = (CollisionPair){a, b};
+}
+
+// Sorts pairs[first, end) by b; each run is one asteroid's few neighbours.
+void sortPairRun(CollisionPair *pairs, int first, int end) {
+    for (int p = first + 1; p < end; p++) {
+        CollisionPair key = pairs[p];
+        int q = p - 1;
+        while (q >= first && pairs[q].b > key.b) {
+            pairs[q + 1] = pairs[q];
+            q--;
+        }
+        pairs[q + 1] = key;
+    }
+}
+
+// Emits candidate pairs (a < b) sorted by (a, b), which is the order the
+// brute-force loop visits them in. The list holds every pair within
+// g->margin of touching; resolvePairs() covers the rest.
+void findGridPairs(SpatialGrid *g, const AsteroidStore *as) {
+    g->pairs.count = 0;
+
+    for (int i = 0; i < as->count; i++) {
+        int cell = g->itemCell[i];
+        int first = g->pairs.count;
+        int cx = cell % g->cols;
+        int cy = cell / g->cols;
+
+        for (int ny = cy - 1; ny <= cy + 1; ny++) {
+            if (ny < 0 || ny >= g->rows)
+                continue;
+            for (int nx = cx - 1; nx <= cx + 1; nx++) {
+                if (nx < 0 || nx >= g->cols)
+                    continue;
+                int n = ny * g->cols + nx;
+                for (int k = g->cellStart[n]; k < g->cellStart[n + 1]; k++) {
+                    int j = g->cellItems[k];
+                    if (j > i)
+                        pushPair(&g->pairs, i, j);
+                }
+            }
+        }
+        sortPairRun(g->pairs.items, first, g->pairs.count);
+    }
+}
+
+int compareSapEntries(const void *a, const void *b) {
+    const SapEntry *x = a;
+    const SapEntry *y = b;
+    if (x->minX != y->minX)
+        return (x->minX > y->minX) - (x->minX < y->minX);
+    return x->id - y->id;
+}
+
+void reserveSap(SweepAndPrune *s, int capacity) {
+    if (s->capacity >= capacity)
+        return;
+    s->entries = resizeArray(s->entries, capacity, sizeof(SapEntry));
+    s->bucketStart = resizeArray(s->bucketStart, capacity + 1, sizeof(int));
+    s->capacity = capacity;
+}
+
+// Appends the entry for a newly created asteroid; the next pass sorts it in.
+// Asteroids created after the list went out of step (e.g. the store was
+// cleared directly) just leave it stale.
+void sapInsert(SweepAndPrune *s, const AsteroidStore *as, int id) {
+    if (s->stale || s->count != id) {
+        s->stale = 1;
+        return;
+    }
+    reserveSap(s, as->capacity);
+    s->entries[s->count++] = (SapEntry){as->posX[id] - as->radius[id], id};
+}
+
+// Mirrors removeAsteroid(): drops i's entry and relabels last's entry as i,
+// keeping every other entry where it is.
+void sapRemove(SweepAndPrune *s, int i, int last) {
+    if (s->stale || s->count != last + 1) {
+        s->stale = 1;
+        return;
+    }
+    int k = 0;
+    while (s->entries[k].id != i)
+        k++;
+    memmove(&s->entries[k], &s->entries[k + 1], sizeof(SapEntry) * (size_t)(s->count - k - 1));
+    s->count--;
+    for (k = 0; k < s->count; k++) {
+        if (s->entries[k].id == last) {
+            s->entries[k].id = i;
+            break;
+        }
+    }
+}
+
+// Brings the sorted list up to date with this tick's positions. A stale list
+// is rebuilt with qsort; otherwise last tick's order is nearly sorted already
+// and insertion sort only moves the few asteroids that overtook a neighbour.
+void updateSapOrder(SweepAndPrune *s, const AsteroidStore *as) {
+    reserveSap(s, as->capacity);
+
+    if (s->stale || s->count != as->count) {
+        for (int i = 0; i < as->count; i++)
+            s->entries[i] = (SapEntry){as->posX[i] - as->radius[i], i};
+        s->count = as->count;
+        qsort(s->entries, s->count, sizeof(SapEntry), compareSapEntries);
+        s->stale = 0;
+        return;
+    }
+
+    for (int k = 0; k < s->count; k++) {
+        int id = s->entries[k].id;
+        s->entries[k].minX = as->posX[id] - as->radius[id];
+    }
+    for (int k = 1; k < s->count; k++) {
+        SapEntry key = s->entries[k];
+        int q = k - 1;
+        while (q >= 0 && s->entries[q].minX > key.minX) {
+            s->entries[q + 1] = s->entries[q];
+            q--;
+        }
+        s->entries[q + 1] = key;
+    }
+}
+
+// Sweeps the sorted list for bounding boxes that overlap on both axes, then
+// counting-sorts the hits by a so they come out in the same (a, b) order as
+// the brute-force and grid paths. Boxes are padded by s->margin (the largest
+// radius); resolvePairs() covers pairs that corrections push in from further.
+void findSapPairs(SweepAndPrune *s, const AsteroidStore *as) {
+    updateSapOrder(s, as);
+    s->found.count = 0;
+
+    s->margin = 0.0f;
+    for (int i = 0; i < as->count; i++)
+        s->margin = fmaxf(s->margin, as->radius[i]);
+    float pad = s->margin;
+
+    for (int k = 0; k < s->count; k++) {
+        int a = s->entries[k].id;
+        float maxX = as->posX[a] + as->radius[a] + pad;
+        for (int j = k + 1; j < s->count && s->entries[j].minX <= maxX; j++) {
+            int b = s->entries[j].id;
+            if (fabsf(as->posY[a] - as->posY[b]) > as->radius[a] + as->radius[b] + pad)
+                continue;
+            if (a < b)
+                pushPair(&s->found, a, b);
+            else
+                pushPair(&s->found, b, a);
+        }
+    }
+
+    if (s->pairs.capacity < s->found.count) {
+        s->pairs.capacity = s->found.capacity;
+        s->pairs.items = resizeArray(s->pairs.items, s->pairs.capacity, sizeof(CollisionPair));
+    }
+    memset(s->bucketStart, 0, sizeof(int) * (s->count + 1));
+    for (int p = 0; p < s->found.count; p++)
+        s->bucketStart[s->found.items[p].a + 1]++;
+    for (int i = 0; i < s->count; i++)
+        s->bucketStart[i + 1] += s->bucketStart[i];
+    for (int p = 0; p < s->found.count; p++)
+        s->pairs.items[s->bucketStart[s->found.items[p].a]++] = s->found.items[p];
+    s->pairs.count = s->found.count;
+
+    int first = 0;
+    for (int i = 0; i < s->count; i++) {
+        sortPairRun(s->pairs.items, first, s->bucketStart[i]);
+        first = s->bucketStart[i];
+    }
+}
+
+// Visits every pair (a, b) with a >= first, in the brute-force order.
+void resolveRowsFrom(World *w, int first) {
+    for (int i = first; i < w->asteroids.count; i++) {
+        for (int j = i + 1; j < w->asteroids.count; j++) {
+            resolveCollisions(w, i, j);
+        }
+    }
+}
+
+void checkCollisionsBrute(World *w) { resolveRowsFrom(w, 0); }
+
+void reserveCorrections(CorrectionTracker *t, int capacity) {
+    if (t->capacity >= capacity)
+        return;
+    t->moved = resizeArray(t->moved, capacity, sizeof(float));
+    t->loose = resizeArray(t->loose, capacity, sizeof(int));
+    t->startX = resizeArray(t->startX, capacity, sizeof(float));
+    t->startY = resizeArray(t->startY, capacity, sizeof(float));
+    t->capacity = capacity;
+}
+
+// When the last pass gave up on its candidates, runs this one as the plain
+// loop without building any. Corrections then cascade through the field, so
+// the result is the same and the candidate list would only cost time. The
+// net distance each asteroid was pushed is measured afterwards; once few
+// enough went past half the largest radius, the next pass tries candidates
+// again. Returns 0 if the caller should build them.
+int resolvePacked(World *w) {
+    CorrectionTracker *t = &w->corrections;
+    if (!t->packed)
+        return 0;
+
+    AsteroidStore *as = &w->asteroids;
+    int n = as->count;
+    reserveCorrections(t, as->capacity);
+    memcpy(t->startX, as->posX, sizeof(float) * n);
+    memcpy(t->startY, as->posY, sizeof(float) * n);
+    resolveRowsFrom(w, 0);
+
+    float maxRadius = 0.0f;
+    for (int i = 0; i < n; i++)
+        maxRadius = fmaxf(maxRadius, as->radius[i]);
+    int loose = 0;
+    for (int i = 0; i < n; i++) {
+        if (fabsf(as->posX[i] - t->startX[i]) + fabsf(as->posY[i] - t->startY[i]) >
+            0.5f * maxRadius)
+            loose++;
+    }
+    t->packed = loose > n / CONTACT_LOOSE_FRACTION;
+    return 1;
+}
+
+// Resolves one pair and adds how far each asteroid moved to its tally,
+// inserting it into the loose list when it first passes the limit.
+void resolveTracked(World *w, CorrectionTracker *t, int a, int b, float limit) {
+    AsteroidStore *as = &w->asteroids;
+    int ids[2] = {a, b};
+    float x[2] = {as->posX[a], as->posX[b]};
+    float y[2] = {as->posY[a], as->posY[b]};
+    resolveCollisions(w, a, b);
+
+    for (int k = 0; k < 2; k++) {
+        int id = ids[k];
+        if (t->moved[id] > limit)
+            continue;
+        t->moved[id] += fabsf(as->posX[id] - x[k]) + fabsf(as->posY[id] - y[k]);
+        if (t->moved[id] <= limit)
+            continue;
+        int q = t->looseCount++;
+        while (q > 0 && t->loose[q - 1] > id) {
+            t->loose[q] = t->loose[q - 1];
+            q--;
+        }
+        t->loose[q] = id;
+    }
+}
+
+// Index of the first loose asteroid above x.
+int firstLooseAfter(const CorrectionTracker *t, int x) {
+    int lo = 0;
+    int hi = t->looseCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (t->loose[mid] > x)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+// Resolves pairs in the brute-force (a, b) order, taking them from a
+// candidate list that holds every pair within margin of touching when it was
+// built. Corrections earlier in the pass can push a pair outside the list
+// into overlap, but only once one of its asteroids has moved more than half
+// the margin. From then on that asteroid is loose and is paired with every
+// other asteroid, so contacts come out exactly as the brute-force loop
+// resolves them. In a field packed so tight that corrections cascade, enough
+// asteroids go loose that the rest of the pass is cheaper as that loop, and
+// resolvePacked() runs the next passes that way from the start.
+void resolvePairs(World *w, const PairList *pairs, float margin) {
+    AsteroidStore *as = &w->asteroids;
+    CorrectionTracker *t = &w->corrections;
+    reserveCorrections(t, as->capacity);
+    memset(t->moved, 0, sizeof(float) * as->count);
+    t->looseCount = 0;
+    t->packed = 0;
+
+    float limit = 0.5f * margin;
+    int n = as->count;
+    int p = 0;
+    for (int i = 0; i < n; i++) {
+        if (t->looseCount > n / CONTACT_LOOSE_FRACTION) {
+            resolveRowsFrom(w, i);
+            t->packed = 1;
+            return;
+        }
+
+        int end = p;
+        while (end < pairs->count && pairs->items[end].a == i)
+            end++;
+
+        int j = i;
+        while (t->moved[i] <= limit) {
+            while (p < end && pairs->items[p].b <= j)
+                p++;
+            int q = firstLooseAfter(t, j);
+            int next = (p < end) ? pairs->items[p].b : n;
+            if (q < t->looseCount && t->loose[q] < next)
+                next = t->loose[q];
+            if (next == n)
+                break;
+            resolveTracked(w, t, i, next, limit);
+            j = next;
+        }
+        if (t->moved[i] > limit) {
+            for (int k = j + 1; k < n; k++)
+                resolveTracked(w, t, i, k, limit);
+        }
+        p = end;
+    }
+}
+
+void checkCollisionsGrid(World *w) {
+    if (resolvePacked(w))
+        return;
+    SpatialGrid *g = &w->grid;
+    buildGrid(g, &w->asteroids);
+    findGridPairs(g, &w->asteroids);
+    resolvePairs(w, &g->pairs, g->margin);
+}
+
+void checkCollisionsSap(World *w) {
+    if (resolvePacked(w))
+        return;
+    SweepAndPrune *s = &w->sap;
+    findSapPairs(s, &w->asteroids);
+    resolvePairs(w, &s->pairs, s->margin);
+}
+
+// Writes (if out is not NULL) and counts the pairs (i, j > i) from i's grid
+// neighbourhood that overlap right now, sorted by j.
+int gridContacts(const SpatialGrid *g, const AsteroidStore *as, int i, CollisionPair *out) {
+    int cell = g->itemCell[i];
+    int cx = cell % g->cols;
+    int cy = cell / g->cols;
+    int count = 0;
+
+    for (int ny = cy - 1; ny <= cy + 1; ny++) {
+        if (ny < 0 || ny >= g->rows)
+            continue;
+        for (int nx = cx - 1; nx <= cx + 1; nx++) {
+            if (nx < 0 || nx >= g->cols)
+                continue;
+            int n = ny * g->cols + nx;
+            for (int k = g->cellStart[n]; k < g->cellStart[n + 1]; k++) {
+                int j = g->cellItems[k];
+                if (j <= i)
+                    continue;
+                float dx = as->posX[i] - as->posX[j];
+                float dy = as->posY[i] - as->posY[j];
+                float rsum = as->radius[i] + as->radius[j];
+                if (dx * dx + dy * dy >= rsum * rsum)
+                    continue;
+                if (out != NULL)
+                    out[count] = (CollisionPair){i, j};
+                count++;
+            }
+        }
+    }
+    if (out != NULL)
+        sortPairRun(out, 0, count);
+    return count;
+}
+
+int countContactRange(void *ctx, int begin, int end) {
+    ContactJob *job = ctx;
+    for (int i = begin; i < end; i++)
+        job->coloring->pairStart[i + 1] = gridContacts(job->grid, job->as, i, NULL);
+    return 0;
+}
+
+int fillContactRange(void *ctx, int begin, int end) {
+    ContactJob *job = ctx;
+    ContactColoring *c = job->coloring;
+    for (int i = begin; i < end; i++)
+        gridContacts(job->grid, job->as, i, c->contacts.items + c->pairStart[i]);
+    return 0;
+}
+
+int resolveContactRange(void *ctx, int begin, int end) {
+    ContactJob *job = ctx;
+    ContactColoring *c = job->coloring;
+    for (int p = job->offset + begin; p < job->offset + end; p++)
+        c->bounced[p] = (uint8_t)resolveContact(job->as, c->batched[p].a, c->batched[p].b,
+                                                &c->points[p]);
+    return 0;
+}
+
+// Finds overlapping pairs with two parallel passes over the grid (count per
+// asteroid, then fill at prefix-summed offsets), so the list comes out in the
+// same (a, b) order on any number of threads.
+void findContacts(World *w, ContactJob *job) {
+    ContactColoring *c = &w->coloring;
+    AsteroidStore *as = &w->asteroids;
+    if (c->capacity < as->capacity) {
+        c->pairStart = resizeArray(c->pairStart, as->capacity + 1, sizeof(int));
+        c->usedColors = resizeArray(c->usedColors, as->capacity, sizeof(uint64_t));
+        c->capacity = as->capacity;
+    }
+
+    buildGrid(&w->grid, as);
+    c->pairStart[0] = 0;
+    parallelFor(jobSystem, as->count, JOB_GRAIN, countContactRange, job);
+    for (int i = 0; i < as->count; i++)
+        c->pairStart[i + 1] += c->pairStart[i];
+
+    c->contacts.count = c->pairStart[as->count];
+    if (c->contacts.capacity < c->contacts.count) {
+        c->contacts.capacity = c->contacts.count;
+        c->contacts.items =
+            resizeArray(c->contacts.items, c->contacts.capacity, sizeof(CollisionPair));
+    }
+    parallelFor(jobSystem, as->count, JOB_GRAIN, fillContactRange, job);
+}
+
+// Greedy edge colouring in contact order: each contact takes the lowest
+// colour neither of its asteroids has used yet. Contacts are then grouped by
+// colour, keeping their order within a colour.
+void colorContacts(World *w) {
+    ContactColoring *c = &w->coloring;
+    int n = c->contacts.count;
+    if (c->batchedCapacity < n) {
+        c->batched = resizeArray(c->batched, n, sizeof(CollisionPair));
+        c->bounced = resizeArray(c->bounced, n, sizeof(uint8_t));
+        c->points = resizeArray(c->points, n, sizeof(Vector2));
+        c->batchedCapacity = n;
+    }
+
+    memset(c->usedColors, 0, sizeof(uint64_t) * w->asteroids.count);
+    memset(c->colorStart, 0, sizeof(c->colorStart));
+    for (int p = 0; p < n; p++) {
+        CollisionPair pair = c->contacts.items[p];
+        uint64_t open = ~(c->usedColors[pair.a] | c->usedColors[pair.b]);
+        int color = open ? __builtin_ctzll(open) : CONTACT_MAX_COLORS;
+        if (color < CONTACT_MAX_COLORS) {
+            c->usedColors[pair.a] |= 1ull << color;
+            c->usedColors[pair.b] |= 1ull << color;
+        }
+        // Stash the colour in bounced until the scatter below.
+        c->bounced[p] = (uint8_t)color;
+        c->colorStart[color + 1]++;
+    }
+    for (int k = 0; k <= CONTACT_MAX_COLORS; k++)
+        c->colorStart[k + 1] += c->colorStart[k];
+
+    int fill[CONTACT_MAX_COLORS + 1];
+    memcpy(fill, c->colorStart, sizeof(fill));
+    for (int p = 0; p < n; p++)
+        c->batched[fill[c->bounced[p]]++] = c->contacts.items[p];
+}
+
+// Resolves one colour at a time, each in parallel, then queues the contact
+// events serially in batch order. The order differs from the sequential
+// solver, so results differ from it too, but not between thread counts.
+void checkCollisionsColored(World *w) {
+    ContactColoring *c = &w->coloring;
+    ContactJob job = {&w->grid, &w->asteroids, c, 0};
+    findContacts(w, &job);
+    colorContacts(w);
+
+    for (int k = 0; k < CONTACT_MAX_COLORS; k++) {
+        job.offset = c->colorStart[k];
+        parallelFor(jobSystem, c->colorStart[k + 1] - job.offset, JOB_GRAIN, resolveContactRange,
+                    &job);
+    }
+    job.offset = c->colorStart[CONTACT_MAX_COLORS];
+    resolveContactRange(&job, 0, c->colorStart[CONTACT_MAX_COLORS + 1] - job.offset);
+
+    int n = c->contacts.count;
+    for (int p = 0; p < n; p++) {
+        if (c->bounced[p])
+            pushEvent(w, (Event){EVENT_CONTACT, c->batched[p].a, c->batched[p].b, c->points[p], 0});
+    }
+    w->grid.dirty = 1;
+}
+
+const char *broadphaseName(BroadphaseMode m) {
+    switch (m) {
+    case BROADPHASE_BRUTE:
+        return "brute";
+    case BROADPHASE_GRID:
+        return "grid";
+    case BROADPHASE_SAP:
+        return "sap";
+    }
+    return "unknown";
+}
+
+int parseBroadphaseMode(const char *name, BroadphaseMode *out) {
+    for (BroadphaseMode m = BROADPHASE_BRUTE; m <= BROADPHASE_SAP; m++) {
+        if (strcmp(name, broadphaseName(m)) == 0) {
+            *out = m;
+            return 1;
+        }
+    }
+    fprintf(stderr, "unknown broadphase: %s (expected brute, grid or sap)\n", name);
+    return 0;
+}
+
+const char *collisionSolverName(CollisionSolver s) {
+    switch (s) {
+    case SOLVER_SEQUENTIAL:
+        return "sequential";
+    case SOLVER_COLORED:
+        return "colored";
+    }
+    return "unknown";
+}
+
+int parseCollisionSolver(const char *name, CollisionSolver *out) {
+    for (CollisionSolver s = SOLVER_SEQUENTIAL; s <= SOLVER_COLORED; s++) {
+        if (strcmp(name, collisionSolverName(s)) == 0) {
+            *out = s;
+            return 1;
+        }
+    }
+    fprintf(stderr, "unknown collision solver: %s (expected sequential or colored)\n", name);
+    return 0;
+}
+
+void checkCollisions(World *w) {
+    if (collisionSolver == SOLVER_COLORED) {
+        checkCollisionsColored(w);
+        return;
+    }
+
+    switch (broadphaseMode) {
+    case BROADPHASE_BRUTE:
+        checkCollisionsBrute(w);
+        break;
+    case BROADPHASE_GRID:
+        checkCollisionsGrid(w);
+        break;
+    case BROADPHASE_SAP:
+        checkCollisionsSap(w);
+        break;
+    }
+}
+
+void splitAsteroid(World *w, int parentIdx) {
+    AsteroidStore *as = &w->asteroids;
+    Vector2 initPos = {as->posX[parentIdx], as->posY[parentIdx]};
+    float radius = as->radius[parentIdx];
+    AsteroidSize size = as->size[parentIdx];
+
+    emitBurst(w, initPos, (int)(radius / 5), &DEBRIS_BURST);
+
+    removeAsteroid(w, parentIdx);
+    if (radius <= R_SMALL)
+        return;
+
+    int childCount = 0;
+    float childRadius = 0.0f;
+
+    switch (size) {
+    case AST_BIG:
+        childCount = 3;
+        childRadius = radius * 0.55f;
+        break;
+    case AST_MED:
+        childCount = 2;
+        childRadius = radius * 0.60f;
+        break;
+    default:
+        return;
+    }
+
+    for (int i = 0; i < childCount; i++) {
+        Vector2 jitter = Vector2Scale(getRandV(&w->rng[RNG_SPAWN]), childRadius * 0.35f);
+        Vector2 cPos = Vector2Add(initPos, jitter);
+
+        Vector2 velDir = getRandV(&w->rng[RNG_SPAWN]);
+        int idx = createAsteroid(w, cPos, childRadius, velDir);
+        if (idx == -1)
+            continue;
+        as->velX[idx] *= 1.3f;
+        as->velY[idx] *= 1.3f;
+    }
+}
+
+// Written branch-free so the loop vectorizes. Wrapping also snaps the previous
+// position, so interpolation doesn't streak across the screen.
+int updateAsteroidRange(void *ctx, int begin, int end) {
+    AsteroidJob *job = ctx;
+    AsteroidStore *as = job->as;
+    float k = job->k;
+
+    for (int i = begin; i < end; i++) {
+        float x = as->posX[i] + as->velX[i] * k;
+        float y = as->posY[i] + as->velY[i] * k;
+        float r = as->radius[i];
+
+        float wx = (x + r < 0.0f) ? (float)WIDTH : x;
+        wx = (x - r > (float)WIDTH) ? 0.0f : wx;
+        float wy = (y + r < 0.0f) ? (float)HEIGHT : y;
+        wy = (y - r > (float)HEIGHT) ? 0.0f : wy;
+        int wrapped = (wx != x) | (wy != y);
+
+        as->prevX[i] = wrapped ? wx : as->posX[i];
+        as->prevY[i] = wrapped ? wy : as->posY[i];
+        as->posX[i] = wx;
+        as->posY[i] = wy;
+    }
+
+    for (int i = begin; i < end; i++) {
+        as->prevRotation[i] = as->rotation[i];
+        as->rotation[i] += k;
+    }
+    return 0;
+}
+
+void UpdateAsteroids(World *w, float dt) {
+    AsteroidJob job = {&w->asteroids, SCALE * dt * BASE_HZ};
+    parallelFor(jobSystem, w->asteroids.count, JOB_GRAIN, updateAsteroidRange, &job);
+    w->grid.dirty = 1;
+}
+
+// SPACESHIP
+Vector2 initialSpaceshipPosition(const World *w) {
+    Vector2 center = {(float)WIDTH / 2, (float)HEIGHT / 2};
+    Vector2 avg = center;
+    int n = w->asteroids.count;
+    if (n > 0) {
+        avg = (Vector2){0.0f, 0.0f};
+        for (int i = 0; i < n; i++) {
+            avg.x += w->asteroids.posX[i];
+            avg.y += w->asteroids.posY[i];
+        }
+        avg.x /= n;
+        avg.y /= n;
+    }
+
+    Vector2 dir = {center.x - avg.x, center.y - avg.y};
+    Vector2 shipPos = {center.x + dir.x, center.y + dir.y};
+
+    if (shipPos.x < 0)
+        shipPos.x = 0;
+    if (shipPos.y < 0)
+        shipPos.y = 0;
+    if (shipPos.x > WIDTH)
+        shipPos.x = WIDTH;
+    if (shipPos.y > HEIGHT)
+        shipPos.y = HEIGHT;
+
+    return shipPos;
+}
+
+Spaceship initSpaceship(const World *w) {
+    Vector2 pos = initialSpaceshipPosition(w);
+    return (Spaceship){pos, 10, (Vector2){0, 0}, pos};
+}
+
+void MoveSpaceship(Spaceship *s, Input in, float step) {
+    if (in.right)
+        s->pos.x += VEL * step;
+    if (in.left)
+        s->pos.x -= VEL * step;
+    if (in.up)
+        s->pos.y -= VEL * step;
+    if (in.down)
+        s->pos.y += VEL * step;
+}
+
+void UpdateSpaceship(Spaceship *s, Input in, float dt) {
+    float step = dt * BASE_HZ;
+    s->prevPos = s->pos;
+    MoveSpaceship(s, in, step);
+    s->pos.x += s->vel.x * VEL * step;
+    s->pos.y += s->vel.y * VEL * step;
+}
+
+// BULLETS
+void initBullets(World *w) {
+    w->bulletFreeCount = 0;
+    for (int i = w->bulletCapacity - 1; i >= 0; i--) {
+        w->bulletActive[i] = 0;
+        w->bulletFree[w->bulletFreeCount++] = i;
+    }
+}
+
+void createBullet(World *w, Vector2 pos, Vector2 velDir) {
+    if (w->bulletFreeCount == 0 && !growPool(w, &w->bulletCapacity, reserveBullets)) {
+        w->poolStats.bulletDrops++;
+        return;
+    }
+
+    int i = w->bulletFree[--w->bulletFreeCount];
+    w->bullets[i] = (Bullet){pos, 3, velDir, pos};
+    w->bulletActive[i] = 1;
+}
+
+void freeBullet(World *w, int i) {
+    w->bulletActive[i] = 0;
+    w->bulletFree[w->bulletFreeCount++] = i;
+}
+
+void updateBullets(World *w) {
+    for (int i = 0; i < w->bulletCapacity; i++) {
+        if (!w->bulletActive[i])
+            continue;
+        Bullet *b = &w->bullets[i];
+
+        if (b->pos.x + b->radius < 0 || b->pos.x - b->radius > WIDTH || b->pos.y + b->radius < 0 ||
+            b->pos.y - b->radius > HEIGHT) {
+            freeBullet(w, i);
+        }
+    }
+}
+
+int moveBulletRange(void *ctx, int begin, int end) {
+    BulletJob *job = ctx;
+    for (int i = begin; i < end; i++) {
+        if (!job->active[i])
+            continue;
+        Bullet *b = &job->bullets[i];
+        b->prevPos = b->pos;
+        b->pos.x += b->vel.x * BULLET_SPEED * job->step;
+        b->pos.y += b->vel.y * BULLET_SPEED * job->step;
+    }
+    return 0;
+}
+
+void moveBullet(World *w, float dt) {
+    BulletJob job = {w->bullets, w->bulletActive, dt * BASE_HZ};
+    parallelFor(jobSystem, w->bulletCapacity, JOB_GRAIN, moveBulletRange, &job);
+}
+
+// Sweeps each bullet over the tick in the frame of each nearby asteroid, so
+// fast bullets and coarse ticks can't tunnel through small asteroids. The
+// bullet hits whichever asteroid it reaches first, lowest index on a tie.
+void handleBulletAsteroidCollisions(World *w) {
+    AsteroidStore *as = &w->asteroids;
+    for (int bulletIdx = 0; bulletIdx < w->bulletCapacity; bulletIdx++) {
+        if (!w->bulletActive[bulletIdx])
+            continue;
+        Bullet *b = &w->bullets[bulletIdx];
+
+        Vector2 mid = Vector2Scale(Vector2Add(b->prevPos, b->pos), 0.5f);
+        float reach = 0.5f * Vector2Distance(b->prevPos, b->pos) + b->radius;
+        int candidates = queryAsteroids(w, mid, reach);
+
+        int hit = -1;
+        float hitTime = 2.0f;
+        for (int c = 0; c < candidates; c++) {
+            int astIdx = w->grid.queryItems[c];
+            Vector2 start = {b->prevPos.x - as->prevX[astIdx], b->prevPos.y - as->prevY[astIdx]};
+            Vector2 end = {b->pos.x - as->posX[astIdx], b->pos.y - as->posY[astIdx]};
+            float t = sweptCircleTime(start, end, b->radius + as->radius[astIdx]);
+            if (t >= 0.0f && (t < hitTime || (t == hitTime && astIdx < hit))) {
+                hit = astIdx;
+                hitTime = t;
+            }
+        }
+        if (hit == -1)
+            continue;
+
+        freeBullet(w, bulletIdx);
+        pushEvent(w, (Event){EVENT_HIT, hit, bulletIdx, b->pos, 0});
+    }
+}
+
+void tempDisableShooting(float seconds, int *shootingEnabled, double *startTime,
+                         double currentTime) {
+    if (!(*shootingEnabled)) {
+        if ((currentTime - *startTime) >= seconds)
+            *shootingEnabled = 1;
+    }
+}
+
+void Shoot(World *w, Spaceship *s, Input in, int *shootingEnabled, double *startTime,
+           double currentTime, float dt) {
+    if (*shootingEnabled && in.shoot) {
+        Vector2 position = s->pos;
+        createBullet(w, position, (Vector2){1, 0});
+        *shootingEnabled = 0;
+        *startTime = currentTime;
+    }
+    moveBullet(w, dt);
+    handleBulletAsteroidCollisions(w);
+    updateBullets(w);
+}
+
+// EVENTS
+void clearEvents(World *w) {
+    w->events.count = 0;
+    w->events.applied = 0;
+}
+
+void pushEvent(World *w, Event e) {
+    EventQueue *q = &w->events;
+    if (q->count == q->capacity) {
+        q->capacity = q->capacity ? q->capacity * 2 : EVENT_MIN_CAPACITY;
+        q->items = resizeArray(q->items, q->capacity, sizeof(Event));
+    }
+    q->items[q->count++] = e;
+}
+
+// Applies everything queued since the last call. Contacts and hits go in the
+// order they were recorded; asteroids that ran out of hits are then split from
+// the highest index down, so a swap-remove never moves one still waiting its
+// turn. Splits and score are queued as well, for anyone reading the tick back.
+void applyEvents(World *w, int *score) {
+    EventQueue *q = &w->events;
+    AsteroidStore *as = &w->asteroids;
+    int end = q->count;
+
+    for (int e = q->applied; e < end; e++) {
+        Event ev = q->items[e];
+        if (ev.type == EVENT_CONTACT) {
+            emitBurst(w, ev.pos, 3, &SPARK_BURST);
+        } else if (ev.type == EVENT_HIT && ++as->hits[ev.a] == as->maxHits[ev.a]) {
+            Vector2 center = {as->posX[ev.a], as->posY[ev.a]};
+            pushEvent(w, (Event){EVENT_SPLIT, ev.a, -1, center, 0});
+        }
+    }
+
+    int splitEnd = q->count;
+    for (int e = end + 1; e < splitEnd; e++) {
+        Event key = q->items[e];
+        int p = e - 1;
+        while (p >= end && q->items[p].a < key.a) {
+            q->items[p + 1] = q->items[p];
+            p--;
+        }
+        q->items[p + 1] = key;
+    }
+
+    for (int e = end; e < splitEnd; e++) {
+        splitAsteroid(w, q->items[e].a);
+        pushEvent(w, (Event){EVENT_SCORE, -1, -1, q->items[e].pos, 10});
+    }
+    for (int e = splitEnd; e < q->count; e++)
+        *score += q->items[e].value;
+    q->applied = q->count;
+}
+
+// GAME-OVER / WIN
+void checkGameOver(World *w, Spaceship *s, int *gameOver) {
+    const AsteroidStore *as = &w->asteroids;
+    int candidates = queryAsteroids(w, s->pos, s->radius);
+    for (int c = 0; c < candidates; c++) {
+        int i = w->grid.queryItems[c];
+        float dx = s->pos.x - as->posX[i];
+        float dy = s->pos.y - as->posY[i];
+        float r = s->radius + as->radius[i];
+        if (dx * dx + dy * dy <= r * r) {
+            *gameOver = 1;
+            return;
+        }
+    }
+}
+
+int checkWin(const World *w) { return w->asteroids.count == 0; }
+
+void restartGame(World *w, int *gameOver, int *score, Spaceship *spaceship) {
+    initAsteroids(w);
+    *spaceship = initSpaceship(w);
+    *score = 0;
+    *gameOver = 0;
+}
+
+// GAME LOOP
+void initGame(World *w) {
+    Game *g = &w->game;
+    initAsteroids(w);
+    initStars(w);
+    g->ship = initSpaceship(w);
+
+    g->gameOver = 0;
+    g->score = 0;
+    g->shootingEnabled = 1;
+    g->shootingStartTime = 0.0;
+    g->time = 0.0;
+
+    initParticles(w);
+    initBullets(w);
+}
+
+static uint64_t hashBytes(uint64_t h, const void *data, size_t size) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// FNV-1a over the state that gameplay depends on, used to check that a replay
+// ends where the recorded session did.
+uint64_t hashWorld(const World *w) {
+    const Game *g = &w->game;
+    const AsteroidStore *as = &w->asteroids;
+    uint64_t h = 14695981039346656037ULL;
+    h = hashBytes(h, &as->count, sizeof(as->count));
+    h = hashBytes(h, as->posX, sizeof(float) * as->count);
+    h = hashBytes(h, as->posY, sizeof(float) * as->count);
+    h = hashBytes(h, as->velX, sizeof(float) * as->count);
+    h = hashBytes(h, as->velY, sizeof(float) * as->count);
+    h = hashBytes(h, as->hits, sizeof(int) * as->count);
+    h = hashBytes(h, &w->particles.count, sizeof(w->particles.count));
+    h = hashBytes(h, &g->ship.pos, sizeof(g->ship.pos));
+    h = hashBytes(h, &g->score, sizeof(g->score));
+    h = hashBytes(h, &g->gameOver, sizeof(g->gameOver));
+    return h;
+}
+
+// Advances the world by one fixed tick of dt seconds.
+void updateGame(World *w, Input in, float dt) {
+    Game *g = &w->game;
+    PROFILE(PHASE_UPDATE_STARS, updateStars(w, dt));
+    if (g->gameOver) {
+        if (in.restart)
+            restartGame(w, &g->gameOver, &g->score, &g->ship);
+        return;
+    }
+
+    g->time += dt;
+    clearEvents(w);
+    PROFILE(PHASE_UPDATE_ASTEROIDS, UpdateAsteroids(w, dt));
+    PROFILE(PHASE_UPDATE_SHIP, UpdateSpaceship(&g->ship, in, dt));
+    PROFILE(PHASE_COLLISIONS, checkCollisions(w));
+    PROFILE(PHASE_EVENTS, applyEvents(w, &g->score));
+    PROFILE(PHASE_UPDATE_PARTICLES, updateParticles(w, dt));
+    tempDisableShooting(0.3f, &g->shootingEnabled, &g->shootingStartTime, g->time);
+    PROFILE(PHASE_SHOOT,
+            Shoot(w, &g->ship, in, &g->shootingEnabled, &g->shootingStartTime, g->time, dt));
+    PROFILE(PHASE_EVENTS, applyEvents(w, &g->score));
+    PROFILE(PHASE_GAME_OVER, checkGameOver(w, &g->ship, &g->gameOver));
+
+    if (checkWin(w) && in.restart)
+        restartGame(w, &g->gameOver, &g->score, &g->ship);
+}
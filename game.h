@@ -0,0 +1,491 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "jobs.h"
+#include "profiler.h"
+#include "rng.h"
+#include "raylib.h"
+#include "raymath.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CONSTANTS
+#define WIDTH 800
+#define HEIGHT 600
+
+#define DEFAULT_MAX_ASTEROIDS 64
+#define NUM_START_ASTEROIDS 6
+#define MIN_START_RADIUS 35
+#define MAX_START_RADIUS 65
+
+#define R_BIG 55.0f
+#define R_MED 35.0f
+#define R_SMALL 18.0f
+
+#define ASTEROID_MIN_SIDES 3
+#define ASTEROID_MAX_SIDES 8
+
+#define SCALE 0.8f
+#define VEL 2.0f
+#define BULLET_SPEED 5.0f
+#define DEFAULT_MAX_BULLETS 10
+
+#define DEFAULT_MAX_STARS 100
+#define DEFAULT_MAX_PARTICLES 200
+
+// Speeds above are per tick at BASE_HZ; other tick rates scale them by dt.
+#define BASE_HZ 60.0f
+#define DEFAULT_TICK_HZ 60
+
+#define GRID_MAX_CELLS 1024
+#define GRID_MIN_PAIRS 256
+#define EVENT_MIN_CAPACITY 256
+#define CONTACT_MAX_COLORS 64
+#define CONTACT_LOOSE_FRACTION 32
+
+// Per-entity loops shorter than this run inline. A multiple of 32, so
+// particle chunks never share a deadMask word.
+#define JOB_GRAIN 2048
+
+// TYPES
+typedef enum {
+    AST_SMALL,
+    AST_MED,
+    AST_BIG,
+} AsteroidSize;
+
+// Live asteroids are packed into [0, count) and removed by swapping the last
+// one into the hole, so every loop touches only live entries.
+typedef struct {
+    float *posX, *posY;
+    float *velX, *velY;
+    float *prevX, *prevY;
+    float *radius;
+    float *mass;
+    float *rotation, *prevRotation;
+    int *sides;
+    int *hits;
+    int *maxHits;
+    AsteroidSize *size;
+    int count;
+    int capacity;
+} AsteroidStore;
+
+typedef enum {
+    BROADPHASE_BRUTE,
+    BROADPHASE_GRID,
+    BROADPHASE_SAP,
+} BroadphaseMode;
+
+typedef struct {
+    int a, b;
+} CollisionPair;
+
+typedef struct {
+    CollisionPair *items;
+    int count;
+    int capacity;
+} PairList;
+
+// Asteroids binned by centre into a uniform grid. It serves the broadphase
+// and point/circle queries for bullets and the ship; anything that moves,
+// adds or removes an asteroid marks it dirty and the next query rebuilds it.
+// Cells are packed back to back by a counting sort, so an entry cannot change
+// cell or be swap-removed in place; a rebuild is one O(n) pass instead. A tick
+// builds it for the contact pass, again for the bullet queries because
+// contacts moved asteroids, and a third time for the ship only if a bullet
+// split an asteroid.
+typedef struct {
+    float cellSize;
+    int cols, rows;
+    int cellStart[GRID_MAX_CELLS + 1];
+    int *cellItems;
+    int *itemCell;
+    int itemCapacity;
+    float maxRadius;
+    float maxStep;
+    float margin;
+    int dirty;
+    int *queryItems;
+    PairList pairs;
+} SpatialGrid;
+
+// How far each asteroid has been pushed by overlap corrections so far in the
+// current resolve pass. Asteroids pushed past half the candidate margin are
+// kept sorted in loose, since the candidate list no longer covers them.
+// packed is set when the last pass gave up on its candidates; startX/startY
+// hold positions from before a pass that skipped them.
+typedef struct {
+    float *moved;
+    int *loose;
+    int looseCount;
+    int packed;
+    float *startX, *startY;
+    int capacity;
+} CorrectionTracker;
+
+typedef enum {
+    SOLVER_SEQUENTIAL,
+    SOLVER_COLORED,
+} CollisionSolver;
+
+typedef struct {
+    float minX;
+    int id;
+} SapEntry;
+
+// Sweep-and-prune along x. Entries stay sorted by the left edge of each
+// asteroid's bounding box from one tick to the next, so re-sorting is an
+// almost linear insertion sort. A new asteroid's entry is appended and sorted
+// in by that pass; a removed one's entry is dropped and the entry of the
+// asteroid swapped into its slot relabelled, so the order survives both. Only
+// a world reset or snapshot restore marks the list stale, and the next pass
+// rebuilds it with qsort.
+typedef struct {
+    SapEntry *entries;
+    int count;
+    int stale;
+    int *bucketStart;
+    int capacity;
+    float margin;
+    PairList found;
+    PairList pairs;
+} SweepAndPrune;
+
+// Contacts split into colours such that no asteroid appears twice in one
+// colour, so each colour can be resolved in parallel. Contacts that find all
+// CONTACT_MAX_COLORS colours taken at one of their asteroids go in a last
+// batch that is resolved serially.
+typedef struct {
+    PairList contacts;
+    int *pairStart;
+    uint64_t *usedColors;
+    int capacity;
+    int colorStart[CONTACT_MAX_COLORS + 2];
+    CollisionPair *batched;
+    uint8_t *bounced;
+    Vector2 *points;
+    int batchedCapacity;
+} ContactColoring;
+
+typedef enum {
+    EVENT_CONTACT, // asteroids a and b bounced off each other at pos
+    EVENT_HIT,     // bullet b struck asteroid a at pos
+    EVENT_SPLIT,   // asteroid a ran out of hits and broke up at pos
+    EVENT_SCORE,   // value points were scored
+} EventType;
+
+typedef struct {
+    EventType type;
+    int a, b;
+    Vector2 pos;
+    int value;
+} Event;
+
+// Everything that happened this tick, in order. Collision and hit tests only
+// append to it; applyEvents() then spawns sparks, splits asteroids and adds
+// score in one pass, and the whole list stays readable until the next tick.
+typedef struct {
+    Event *items;
+    int count;
+    int capacity;
+    int applied;
+} EventQueue;
+
+typedef struct {
+    Vector2 pos;
+    float radius;
+    Vector2 vel;
+    Vector2 prevPos;
+} Spaceship;
+
+typedef struct {
+    Vector2 pos;
+    float radius;
+    Vector2 vel;
+    Vector2 prevPos;
+} Bullet;
+
+typedef struct {
+    Vector2 pos;
+    float brightness;
+    float phase;
+} Star;
+
+// When a full pool cannot grow, new particles evict old ones of the same or
+// lower priority, lowest priority and most faded first.
+typedef enum {
+    PARTICLE_SPARK,
+    PARTICLE_DEBRIS,
+} ParticlePriority;
+
+// Live particles are packed into [0, count). The update kernels integrate
+// them and flag expired ones in deadMask, then a compaction pass swaps the
+// survivors down.
+typedef struct {
+    float *posX, *posY;
+    float *velX, *velY;
+    float *prevX, *prevY;
+    float *lifetime;
+    float *invMaxLifetime;
+    float *fade;
+    float *size;
+    Color *color;
+    uint8_t *priority;
+    uint32_t *deadMask;
+    int *victims;
+    int count;
+    int capacity;
+} ParticleStore;
+
+// How emitBurst() dresses a burst: each particle flies off in a random
+// direction at a speed in [minSpeed, maxSpeed] with a colour from palette.
+typedef struct {
+    float minSpeed, maxSpeed;
+    const Color *palette;
+    int paletteSize;
+    float lifetime;
+    float size;
+    ParticlePriority priority;
+} BurstStyle;
+
+typedef enum {
+    PARTICLE_KERNEL_AUTO,
+    PARTICLE_KERNEL_SCALAR,
+    PARTICLE_KERNEL_SSE2,
+    PARTICLE_KERNEL_AVX2,
+} ParticleKernel;
+
+// Pool capacities chosen at startup. With growable set, a full pool doubles
+// instead of dropping the spawn; slots are indices, so growth never
+// invalidates them.
+typedef struct {
+    int maxAsteroids;
+    int maxParticles;
+    int maxBullets;
+    int maxStars;
+    int growable;
+} PoolConfig;
+
+#define DEFAULT_POOL_CONFIG                                                                        \
+    ((PoolConfig){DEFAULT_MAX_ASTEROIDS, DEFAULT_MAX_PARTICLES, DEFAULT_MAX_BULLETS,               \
+                  DEFAULT_MAX_STARS, 0})
+
+// Spawns that found their pool full and were dropped, particles evicted to
+// make room for new ones, and pool growths.
+typedef struct {
+    long asteroidDrops;
+    long particleDrops;
+    long particleEvictions;
+    long bulletDrops;
+    long growths;
+} PoolStats;
+
+// How each round starts: asteroid count and the range of their radii.
+typedef struct {
+    int startAsteroids;
+    int minRadius;
+    int maxRadius;
+} SpawnConfig;
+
+#define DEFAULT_SPAWN_CONFIG                                                                       \
+    ((SpawnConfig){NUM_START_ASTEROIDS, MIN_START_RADIUS, MAX_START_RADIUS})
+
+typedef struct {
+    int right, left, up, down;
+    int shoot;
+    int restart;
+} Input;
+
+typedef enum {
+    PHASE_UPDATE_STARS,
+    PHASE_UPDATE_ASTEROIDS,
+    PHASE_UPDATE_SHIP,
+    PHASE_COLLISIONS,
+    PHASE_UPDATE_PARTICLES,
+    PHASE_SHOOT,
+    PHASE_EVENTS,
+    PHASE_GAME_OVER,
+    PHASE_DRAW_STARS,
+    PHASE_DRAW_PARTICLES,
+    PHASE_DRAW_ASTEROIDS,
+    PHASE_DRAW_HUD,
+    PHASE_PRESENT,
+    PHASE_FRAME,
+    PHASE_COUNT,
+} Phase;
+
+// Independent random streams, all derived from the one run seed. Keeping them
+// apart means e.g. extra debris particles never change where asteroids spawn.
+typedef enum {
+    RNG_SPAWN,
+    RNG_DEBRIS,
+    RNG_STARS,
+    RNG_STREAM_COUNT,
+} RngStream;
+
+typedef struct {
+    Spaceship ship;
+    int score;
+    int gameOver;
+    int shootingEnabled;
+    double shootingStartTime;
+    double time;
+} Game;
+
+// Everything one simulation owns. Worlds share nothing mutable, so any number
+// of them can be stepped at once from different threads.
+typedef struct {
+    AsteroidStore asteroids;
+    ParticleStore particles;
+    Bullet *bullets;
+    int *bulletActive;
+    int *bulletFree;
+    int bulletFreeCount;
+    int bulletCapacity;
+    Star *stars;
+    int starCount;
+    SpatialGrid grid;
+    SweepAndPrune sap;
+    CorrectionTracker corrections;
+    ContactColoring coloring;
+    EventQueue events;
+    PoolConfig pools;
+    PoolStats poolStats;
+    SpawnConfig spawn;
+    Rng rng[RNG_STREAM_COUNT];
+    Game game;
+} World;
+
+// Arguments for the per-entity loops that go through parallelFor().
+typedef struct {
+    Star *stars;
+    float step;
+} StarJob;
+
+typedef struct {
+    ParticleStore *ps;
+    float step, dt;
+} ParticleJob;
+
+typedef struct {
+    AsteroidStore *as;
+    float k;
+} AsteroidJob;
+
+typedef struct {
+    Bullet *bullets;
+    const int *active;
+    float step;
+} BulletJob;
+
+typedef struct {
+    const SpatialGrid *grid;
+    AsteroidStore *as;
+    ContactColoring *coloring;
+    int offset;
+} ContactJob;
+
+// GLOBAL STATE
+extern const char *const PHASE_NAMES[PHASE_COUNT];
+extern Profiler PROFILER;
+
+extern BroadphaseMode broadphaseMode;
+extern ParticleKernel particleKernel;
+extern CollisionSolver collisionSolver;
+extern JobSystem *jobSystem;
+
+#define PROFILE(phase, call)                                                                       \
+    do {                                                                                           \
+        profBegin(&PROFILER, phase);                                                               \
+        call;                                                                                      \
+        profEnd(&PROFILER, phase);                                                                 \
+    } while (0)
+
+// POOLS
+void *resizeArray(void *p, int count, size_t elemSize);
+void reserveAsteroids(World *w, int capacity);
+void reserveParticles(World *w, int capacity);
+void reserveBullets(World *w, int capacity);
+
+// WORLD
+void initWorld(World *w, PoolConfig pools, SpawnConfig spawn);
+void freeWorld(World *w);
+void seedWorld(World *w, uint64_t seed);
+
+// STARS
+void initStars(World *w);
+void updateStars(World *w, float dt);
+
+// PARTICLES
+void initParticles(World *w);
+void createParticle(World *w, Vector2 pos, Vector2 vel, Color color, float lifetime, float size,
+                    ParticlePriority priority);
+int evictParticles(World *w, int count, ParticlePriority priority);
+int emitBurst(World *w, Vector2 pos, int count, const BurstStyle *style);
+int integrateParticlesScalar(ParticleStore *ps, int begin, int end, float step, float dt);
+int integrateParticles(ParticleStore *ps, int begin, int end, float step, float dt);
+ParticleKernel resolveParticleKernel(ParticleKernel k);
+const char *particleKernelName(ParticleKernel k);
+int parseParticleKernel(const char *name, ParticleKernel *out);
+void updateParticles(World *w, float dt);
+
+// HELPERS
+Vector2 getRandV(Rng *r);
+AsteroidSize getAsteroidSize(float r);
+int maxHitsFromSize(AsteroidSize s);
+float sweptCircleTime(Vector2 start, Vector2 end, float radius);
+int parsePositive(const char *flag, const char *value, int *out);
+
+// ASTEROIDS
+int createAsteroid(World *w, Vector2 pos, float r, Vector2 velDir);
+void removeAsteroid(World *w, int i);
+void initAsteroids(World *w);
+int resolveContact(AsteroidStore *as, int ia, int ib, Vector2 *contact);
+void resolveCollisions(World *w, int ia, int ib);
+void splitAsteroid(World *w, int parentIdx);
+void UpdateAsteroids(World *w, float dt);
+
+// BROADPHASE
+void buildGrid(SpatialGrid *g, const AsteroidStore *as);
+void findGridPairs(SpatialGrid *g, const AsteroidStore *as);
+int queryAsteroids(World *w, Vector2 center, float radius);
+void sapInsert(SweepAndPrune *s, const AsteroidStore *as, int id);
+void sapRemove(SweepAndPrune *s, int i, int last);
+void findSapPairs(SweepAndPrune *s, const AsteroidStore *as);
+const char *broadphaseName(BroadphaseMode m);
+int parseBroadphaseMode(const char *name, BroadphaseMode *out);
+const char *collisionSolverName(CollisionSolver s);
+int parseCollisionSolver(const char *name, CollisionSolver *out);
+void checkCollisions(World *w);
+
+// SPACESHIP
+Spaceship initSpaceship(const World *w);
+void UpdateSpaceship(Spaceship *s, Input in, float dt);
+
+// BULLETS
+void initBullets(World *w);
+void createBullet(World *w, Vector2 pos, Vector2 velDir);
+void updateBullets(World *w);
+void moveBullet(World *w, float dt);
+void handleBulletAsteroidCollisions(World *w);
+void Shoot(World *w, Spaceship *s, Input in, int *shootingEnabled, double *startTime,
+           double currentTime, float dt);
+
+// GAME-OVER / WIN
+void checkGameOver(World *w, Spaceship *s, int *gameOver);
+int checkWin(const World *w);
+void restartGame(World *w, int *gameOver, int *score, Spaceship *spaceship);
+
+// EVENTS
+void clearEvents(World *w);
+void pushEvent(World *w, Event e);
+void applyEvents(World *w, int *score);
+
+// GAME LOOP
+void initGame(World *w);
+void updateGame(World *w, Input in, float dt);
+uint64_t hashWorld(const World *w);
+
+#endif
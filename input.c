@@ -0,0 +1,74 @@
+#include "input.h"
+
+#include <stdio.h>
+
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+void initInputQueue(InputQueue *q) {
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+int pushInputEvent(InputQueue *q, InputEvent e) {
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail - head == INPUT_QUEUE_SIZE)
+        return 0;
+    q->events[tail & INPUT_QUEUE_MASK] = e;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+int peekInputEvent(InputQueue *q, InputEvent *out) {
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head == tail)
+        return 0;
+    *out = q->events[head & INPUT_QUEUE_MASK];
+    return 1;
+}
+
+void popInputEvent(InputQueue *q) {
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+int applyInputEvent(Input *in, InputEvent e) {
+    switch ((InputKey)e.key) {
+    case INPUT_KEY_RIGHT:
+        in->right = e.down;
+        return 1;
+    case INPUT_KEY_LEFT:
+        in->left = e.down;
+        return 1;
+    case INPUT_KEY_UP:
+        in->up = e.down;
+        return 1;
+    case INPUT_KEY_DOWN:
+        in->down = e.down;
+        return 1;
+    case INPUT_KEY_SHOOT:
+        in->shoot = 1;
+        return 1;
+    case INPUT_KEY_RESTART:
+        in->restart = 1;
+        return 1;
+    case INPUT_KEY_QUICKSAVE:
+    case INPUT_KEY_QUICKLOAD:
+        break;
+    }
+    return 0;
+}
+
+void recordInputLatency(InputLatency *l, double seconds) {
+    l->count++;
+    l->total += seconds;
+    if (seconds > l->max)
+        l->max = seconds;
+}
+
+void printInputLatency(const InputLatency *l) {
+    double avg = l->count > 0 ? l->total / l->count : 0.0;
+    printf("input_latency_ms: events=%ld avg=%.3f max=%.3f\n", l->count, avg * 1000.0,
+           l->max * 1000.0);
+}
@@ -0,0 +1,59 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "game.h"
+
+#include <stdatomic.h>
+
+// Must be a power of two.
+#define INPUT_QUEUE_SIZE 256
+
+typedef enum {
+    INPUT_KEY_RIGHT,
+    INPUT_KEY_LEFT,
+    INPUT_KEY_UP,
+    INPUT_KEY_DOWN,
+    INPUT_KEY_SHOOT,
+    INPUT_KEY_RESTART,
+    INPUT_KEY_QUICKSAVE,
+    INPUT_KEY_QUICKLOAD,
+} InputKey;
+
+// A held key going down or up, or a one-shot press (down set), stamped with
+// the profNow() time it was sampled at.
+typedef struct {
+    double time;
+    uint8_t key;
+    uint8_t down;
+} InputEvent;
+
+// Lock-free ring for exactly one producer and one consumer. Each index is
+// written by one side only and lives on its own cache line.
+typedef struct {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+} InputQueue;
+
+// Time from sampling an input to the tick that acts on it.
+typedef struct {
+    long count;
+    double total;
+    double max;
+} InputLatency;
+
+void initInputQueue(InputQueue *q);
+// Producer side. Returns 0 if the queue is full.
+int pushInputEvent(InputQueue *q, InputEvent e);
+// Consumer side: look at the oldest event, then drop it once handled.
+int peekInputEvent(InputQueue *q, InputEvent *out);
+void popInputEvent(InputQueue *q);
+
+// Folds a movement, shoot or restart event into in. Returns 0 for keys that
+// are not part of Input.
+int applyInputEvent(Input *in, InputEvent e);
+
+void recordInputLatency(InputLatency *l, double seconds);
+void printInputLatency(const InputLatency *l);
+
+#endif
@@ -0,0 +1,196 @@
+#include "jobs.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JOBS_MIN_DEQUE 64
+#define JOBS_CHUNKS_PER_WORKER 4
+
+// Index of this thread's deque in the pool it works for; threads outside any
+// pool share the last one.
+static _Thread_local int workerIndex = -1;
+
+static int ownDeque(const JobSystem *js) {
+    return workerIndex >= 0 ? workerIndex : js->workerCount;
+}
+
+static void pushJob(JobDeque *d, Job job) {
+    pthread_mutex_lock(&d->lock);
+    if (d->count == d->capacity) {
+        int capacity = d->capacity ? d->capacity * 2 : JOBS_MIN_DEQUE;
+        Job *jobs = malloc(sizeof(Job) * (size_t)capacity);
+        if (jobs == NULL) {
+            fprintf(stderr, "out of memory growing job deque to %d entries\n", capacity);
+            exit(1);
+        }
+        for (int i = 0; i < d->count; i++)
+            jobs[i] = d->jobs[(d->head + i) % d->capacity];
+        free(d->jobs);
+        d->jobs = jobs;
+        d->head = 0;
+        d->capacity = capacity;
+    }
+    d->jobs[(d->head + d->count) % d->capacity] = job;
+    d->count++;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static int popJob(JobDeque *d, Job *out) {
+    pthread_mutex_lock(&d->lock);
+    int found = d->count > 0;
+    if (found)
+        *out = d->jobs[(d->head + --d->count) % d->capacity];
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+static int stealJob(JobDeque *d, Job *out) {
+    pthread_mutex_lock(&d->lock);
+    int found = d->count > 0;
+    if (found) {
+        *out = d->jobs[d->head];
+        d->head = (d->head + 1) % d->capacity;
+        d->count--;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return found;
+}
+
+// Newest job from our own deque first, then the oldest from everyone else's.
+static int findJob(JobSystem *js, Job *out) {
+    int self = ownDeque(js);
+    int n = js->workerCount + 1;
+    int found = popJob(&js->deques[self], out);
+    for (int i = 1; !found && i < n; i++)
+        found = stealJob(&js->deques[(self + i) % n], out);
+    if (found)
+        atomic_fetch_sub(&js->queued, 1);
+    return found;
+}
+
+static void runJob(Job *job) {
+    int result = job->fn(job->ctx, job->begin, job->end);
+    atomic_fetch_add(&job->counter->result, result);
+    atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+}
+
+static void wakeWorkers(JobSystem *js) {
+    pthread_mutex_lock(&js->idleLock);
+    pthread_cond_broadcast(&js->idleCond);
+    pthread_mutex_unlock(&js->idleLock);
+}
+
+static void *workerMain(void *arg) {
+    JobSystem *js = arg;
+    workerIndex = atomic_fetch_add(&js->nextIndex, 1);
+
+    while (atomic_load(&js->running)) {
+        Job job;
+        if (findJob(js, &job)) {
+            runJob(&job);
+            continue;
+        }
+        pthread_mutex_lock(&js->idleLock);
+        while (atomic_load(&js->running) && atomic_load(&js->queued) == 0)
+            pthread_cond_wait(&js->idleCond, &js->idleLock);
+        pthread_mutex_unlock(&js->idleLock);
+    }
+    return NULL;
+}
+
+int jobsInit(JobSystem *js, int workers, int deterministic) {
+    memset(js, 0, sizeof(*js));
+    js->workerCount = workers;
+    js->deterministic = deterministic;
+    js->deques = calloc((size_t)workers + 1, sizeof(JobDeque));
+    js->threads = calloc((size_t)workers, sizeof(pthread_t));
+    if (js->deques == NULL || js->threads == NULL) {
+        fprintf(stderr, "out of memory starting %d job workers\n", workers);
+        exit(1);
+    }
+    for (int i = 0; i <= workers; i++)
+        pthread_mutex_init(&js->deques[i].lock, NULL);
+    pthread_mutex_init(&js->idleLock, NULL);
+    pthread_cond_init(&js->idleCond, NULL);
+    atomic_store(&js->running, 1);
+
+    int started = 0;
+    while (started < workers && pthread_create(&js->threads[started], NULL, workerMain, js) == 0)
+        started++;
+
+    if (started < workers) {
+        js->workerCount = started;
+        jobsShutdown(js);
+        return 0;
+    }
+    return 1;
+}
+
+void jobsShutdown(JobSystem *js) {
+    atomic_store(&js->running, 0);
+    wakeWorkers(js);
+    for (int i = 0; i < js->workerCount; i++)
+        pthread_join(js->threads[i], NULL);
+
+    for (int i = 0; i <= js->workerCount; i++) {
+        free(js->deques[i].jobs);
+        pthread_mutex_destroy(&js->deques[i].lock);
+    }
+    pthread_mutex_destroy(&js->idleLock);
+    pthread_cond_destroy(&js->idleCond);
+    free(js->deques);
+    free(js->threads);
+    memset(js, 0, sizeof(*js));
+}
+
+void jobsSubmit(JobSystem *js, Job job) {
+    atomic_fetch_add(&job.counter->pending, 1);
+    pushJob(&js->deques[ownDeque(js)], job);
+    atomic_fetch_add(&js->queued, 1);
+    wakeWorkers(js);
+}
+
+void jobsWait(JobSystem *js, JobCounter *c) {
+    while (atomic_load_explicit(&c->pending, memory_order_acquire) > 0) {
+        Job job;
+        if (findJob(js, &job))
+            runJob(&job);
+        else
+            sched_yield();
+    }
+}
+
+int parallelFor(JobSystem *js, int count, int grain, JobFn fn, void *ctx) {
+    if (js == NULL || count <= grain)
+        return fn(ctx, 0, count);
+
+    int chunk = grain;
+    if (!js->deterministic) {
+        int target = count / ((js->workerCount + 1) * JOBS_CHUNKS_PER_WORKER);
+        chunk = (target + grain - 1) / grain * grain;
+        if (chunk < grain)
+            chunk = grain;
+    }
+
+    JobCounter counter;
+    atomic_init(&counter.pending, 0);
+    atomic_init(&counter.result, 0);
+
+    // The first chunk is kept for the caller, so it starts working at once.
+    JobDeque *own = &js->deques[ownDeque(js)];
+    int queued = 0;
+    for (int begin = chunk; begin < count; begin += chunk) {
+        int end = begin + chunk < count ? begin + chunk : count;
+        atomic_fetch_add(&counter.pending, 1);
+        pushJob(own, (Job){fn, ctx, begin, end, &counter});
+        queued++;
+    }
+    atomic_fetch_add(&js->queued, queued);
+    wakeWorkers(js);
+
+    int result = fn(ctx, 0, chunk);
+    jobsWait(js, &counter);
+    return result + atomic_load(&counter.result);
+}
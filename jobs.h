@@ -0,0 +1,63 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// A job runs fn over [begin, end) of some index range and returns a count
+// that is summed into its counter's result (e.g. particles that died).
+typedef int (*JobFn)(void *ctx, int begin, int end);
+
+// Tracks a group of jobs: pending drops to zero once all of them have run.
+typedef struct {
+    atomic_int pending;
+    atomic_int result;
+} JobCounter;
+
+typedef struct {
+    JobFn fn;
+    void *ctx;
+    int begin, end;
+    JobCounter *counter;
+} Job;
+
+// Ring buffer of jobs. The owning worker pushes and pops at the tail; idle
+// workers steal the oldest job from the head.
+typedef struct {
+    Job *jobs;
+    int head;
+    int count;
+    int capacity;
+    pthread_mutex_t lock;
+} JobDeque;
+
+// Worker threads, one deque each, plus one extra deque shared by threads
+// outside the pool. A thread waiting on a counter runs jobs while it waits
+// instead of blocking, so callers add themselves to the pool.
+typedef struct {
+    JobDeque *deques;
+    pthread_t *threads;
+    int workerCount;
+    int deterministic;
+    atomic_int running;
+    atomic_int queued;
+    atomic_int nextIndex;
+    pthread_mutex_t idleLock;
+    pthread_cond_t idleCond;
+} JobSystem;
+
+// Starts the worker threads. Returns 0 if one could not be created.
+int jobsInit(JobSystem *js, int workers, int deterministic);
+void jobsShutdown(JobSystem *js);
+
+void jobsSubmit(JobSystem *js, Job job);
+void jobsWait(JobSystem *js, JobCounter *c);
+
+// Splits [0, count) into chunks of a multiple of grain and runs fn over them,
+// returning the sum of fn's results. Ranges of at most grain, and a NULL job
+// system, run inline on the caller. In deterministic mode chunks are exactly
+// grain long whatever the worker count; otherwise they are sized so each
+// worker gets a few.
+int parallelFor(JobSystem *js, int count, int grain, JobFn fn, void *ctx);
+
+#endif
@@ -0,0 +1,98 @@
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+double profNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void profInit(Profiler *p, const char *const *names, int count) {
+    memset(p, 0, sizeof(*p));
+    if (count > PROF_MAX_PHASES)
+        count = PROF_MAX_PHASES;
+    for (int i = 0; i < count; i++)
+        p->phases[i].name = names[i];
+    p->phaseCount = count;
+}
+
+int profOpenCsv(Profiler *p, const char *path) {
+    p->csv = fopen(path, "w");
+    if (p->csv == NULL)
+        return 0;
+
+    fprintf(p->csv, "frame");
+    for (int i = 0; i < p->phaseCount; i++)
+        fprintf(p->csv, ",%s_ms", p->phases[i].name);
+    fprintf(p->csv, "\n");
+    return 1;
+}
+
+void profClose(Profiler *p) {
+    if (p->csv != NULL)
+        fclose(p->csv);
+    p->csv = NULL;
+}
+
+void profBegin(Profiler *p, int phase) {
+    if (p->enabled)
+        p->phases[phase].start = profNow();
+}
+
+void profEnd(Profiler *p, int phase) {
+    if (p->enabled)
+        p->phases[phase].frameTotal += profNow() - p->phases[phase].start;
+}
+
+void profEndFrame(Profiler *p) {
+    if (!p->enabled)
+        return;
+
+    if (p->csv != NULL)
+        fprintf(p->csv, "%ld", p->frame);
+
+    for (int i = 0; i < p->phaseCount; i++) {
+        double ms = p->phases[i].frameTotal * 1000.0;
+        p->phases[i].samples[p->head] = ms;
+        p->phases[i].frameTotal = 0.0;
+        if (p->csv != NULL)
+            fprintf(p->csv, ",%.4f", ms);
+    }
+
+    if (p->csv != NULL)
+        fprintf(p->csv, "\n");
+
+    p->head = (p->head + 1) % PROF_WINDOW;
+    if (p->sampleCount < PROF_WINDOW)
+        p->sampleCount++;
+    p->frame++;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+ProfStats profStats(const Profiler *p, int phase) {
+    ProfStats s = {0.0, 0.0, 0.0};
+    int n = p->sampleCount;
+    if (n == 0)
+        return s;
+
+    double sorted[PROF_WINDOW];
+    memcpy(sorted, p->phases[phase].samples, sizeof(double) * n);
+    qsort(sorted, n, sizeof(double), compareDoubles);
+
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        sum += sorted[i];
+
+    s.min = sorted[0];
+    s.avg = sum / n;
+    s.p99 = sorted[(n - 1) * 99 / 100];
+    return s;
+}
@@ -0,0 +1,46 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+
+#define PROF_MAX_PHASES 16
+#define PROF_WINDOW 240
+
+// Per-phase wall-clock timers. Each phase accumulates every begin/end pair
+// inside a frame, and profEndFrame() pushes the totals into a rolling window
+// of the last PROF_WINDOW frames (and a CSV row, if a file is open).
+typedef struct {
+    const char *name;
+    double start;
+    double frameTotal;
+    double samples[PROF_WINDOW];
+} ProfPhase;
+
+typedef struct {
+    ProfPhase phases[PROF_MAX_PHASES];
+    int phaseCount;
+    int enabled;
+    int sampleCount;
+    int head;
+    long frame;
+    FILE *csv;
+} Profiler;
+
+typedef struct {
+    double min, avg, p99;
+} ProfStats;
+
+double profNow(void);
+
+void profInit(Profiler *p, const char *const *names, int count);
+int profOpenCsv(Profiler *p, const char *path);
+void profClose(Profiler *p);
+
+void profBegin(Profiler *p, int phase);
+void profEnd(Profiler *p, int phase);
+void profEndFrame(Profiler *p);
+
+// Stats are in milliseconds over the frames currently in the window.
+ProfStats profStats(const Profiler *p, int phase);
+
+#endif
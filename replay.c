@@ -0,0 +1,193 @@
+#include "replay.h"
+
+#include <string.h>
+
+static const char REPLAY_MAGIC[4] = {'A', 'S', 'T', 'R'};
+
+enum {
+    INPUT_RIGHT = 1 << 0,
+    INPUT_LEFT = 1 << 1,
+    INPUT_UP = 1 << 2,
+    INPUT_DOWN = 1 << 3,
+    INPUT_SHOOT = 1 << 4,
+    INPUT_RESTART = 1 << 5,
+};
+
+static uint8_t packInput(Input in) {
+    return (in.right ? INPUT_RIGHT : 0) | (in.left ? INPUT_LEFT : 0) | (in.up ? INPUT_UP : 0) |
+           (in.down ? INPUT_DOWN : 0) | (in.shoot ? INPUT_SHOOT : 0) |
+           (in.restart ? INPUT_RESTART : 0);
+}
+
+static Input unpackInput(uint8_t bits) {
+    Input in;
+    in.right = (bits & INPUT_RIGHT) != 0;
+    in.left = (bits & INPUT_LEFT) != 0;
+    in.up = (bits & INPUT_UP) != 0;
+    in.down = (bits & INPUT_DOWN) != 0;
+    in.shoot = (bits & INPUT_SHOOT) != 0;
+    in.restart = (bits & INPUT_RESTART) != 0;
+    return in;
+}
+
+static void writeU16(FILE *f, uint32_t v) {
+    uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+    fwrite(b, 1, sizeof(b), f);
+}
+
+static void writeU32(FILE *f, uint32_t v) {
+    writeU16(f, v & 0xffff);
+    writeU16(f, v >> 16);
+}
+
+static void writeU64(FILE *f, uint64_t v) {
+    writeU32(f, (uint32_t)v);
+    writeU32(f, (uint32_t)(v >> 32));
+}
+
+static int readBytes(FILE *f, uint8_t *b, size_t n) { return fread(b, 1, n, f) == n; }
+
+static int readU16(FILE *f, uint32_t *v) {
+    uint8_t b[2];
+    if (!readBytes(f, b, sizeof(b)))
+        return 0;
+    *v = (uint32_t)b[0] | (uint32_t)b[1] << 8;
+    return 1;
+}
+
+static int readU32(FILE *f, uint32_t *v) {
+    uint32_t lo, hi;
+    if (!readU16(f, &lo) || !readU16(f, &hi))
+        return 0;
+    *v = lo | hi << 16;
+    return 1;
+}
+
+static int readU64(FILE *f, uint64_t *v) {
+    uint32_t lo, hi;
+    if (!readU32(f, &lo) || !readU32(f, &hi))
+        return 0;
+    *v = (uint64_t)lo | (uint64_t)hi << 32;
+    return 1;
+}
+
+static void writeHeader(FILE *f, const ReplayHeader *h) {
+    fwrite(REPLAY_MAGIC, 1, sizeof(REPLAY_MAGIC), f);
+    writeU32(f, REPLAY_VERSION);
+    writeU64(f, h->seed);
+    writeU32(f, (uint32_t)h->tickHz);
+    writeU32(f, (uint32_t)h->pools.maxAsteroids);
+    writeU32(f, (uint32_t)h->pools.maxParticles);
+    writeU32(f, (uint32_t)h->pools.maxBullets);
+    writeU32(f, (uint32_t)h->pools.maxStars);
+    writeU32(f, (uint32_t)h->pools.growable);
+    writeU32(f, (uint32_t)h->broadphase);
+    writeU32(f, (uint32_t)h->solver);
+    writeU64(f, (uint64_t)h->ticks);
+    writeU64(f, h->finalHash);
+}
+
+static int readHeader(FILE *f, ReplayHeader *h) {
+    uint8_t magic[sizeof(REPLAY_MAGIC)];
+    uint32_t version, tickHz, maxAsteroids, maxParticles, maxBullets, maxStars, growable;
+    uint32_t broadphase, solver;
+    uint64_t ticks;
+    if (!readBytes(f, magic, sizeof(magic)) || memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0)
+        return 0;
+    if (!readU32(f, &version) || version != REPLAY_VERSION)
+        return 0;
+    if (!readU64(f, &h->seed) || !readU32(f, &tickHz) || !readU32(f, &maxAsteroids) ||
+        !readU32(f, &maxParticles) || !readU32(f, &maxBullets) || !readU32(f, &maxStars) ||
+        !readU32(f, &growable) || !readU32(f, &broadphase) || !readU32(f, &solver) ||
+        !readU64(f, &ticks) || !readU64(f, &h->finalHash))
+        return 0;
+    if (broadphase > BROADPHASE_SAP || solver > SOLVER_COLORED)
+        return 0;
+
+    h->tickHz = (int)tickHz;
+    h->pools.maxAsteroids = (int)maxAsteroids;
+    h->pools.maxParticles = (int)maxParticles;
+    h->pools.maxBullets = (int)maxBullets;
+    h->pools.maxStars = (int)maxStars;
+    h->pools.growable = (int)growable;
+    h->broadphase = (BroadphaseMode)broadphase;
+    h->solver = (CollisionSolver)solver;
+    h->ticks = (int64_t)ticks;
+    return h->tickHz > 0 && h->pools.maxAsteroids > 0 && h->pools.maxParticles > 0 &&
+           h->pools.maxBullets > 0 && h->pools.maxStars > 0;
+}
+
+static void flushRun(ReplayWriter *w) {
+    if (w->runLength == 0)
+        return;
+    fputc(w->runBits, w->file);
+    writeU16(w->file, w->runLength);
+    w->runLength = 0;
+}
+
+int replayOpenWrite(ReplayWriter *w, const char *path, ReplayHeader header) {
+    memset(w, 0, sizeof(*w));
+    w->file = fopen(path, "wb");
+    if (w->file == NULL)
+        return 0;
+    w->header = header;
+    w->header.ticks = 0;
+    w->header.finalHash = 0;
+    writeHeader(w->file, &w->header);
+    return 1;
+}
+
+void replayWrite(ReplayWriter *w, Input in) {
+    uint8_t bits = packInput(in);
+    if (w->runLength > 0 && (bits != w->runBits || w->runLength == REPLAY_MAX_RUN))
+        flushRun(w);
+    w->runBits = bits;
+    w->runLength++;
+    w->header.ticks++;
+}
+
+// Rewrites the header with the final tick count and state hash.
+int replayCloseWrite(ReplayWriter *w, uint64_t finalHash) {
+    flushRun(w);
+    w->header.finalHash = finalHash;
+    rewind(w->file);
+    writeHeader(w->file, &w->header);
+    int ok = !ferror(w->file);
+    ok &= fclose(w->file) == 0;
+    w->file = NULL;
+    return ok;
+}
+
+int replayOpenRead(ReplayReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    r->file = fopen(path, "rb");
+    if (r->file == NULL)
+        return 0;
+    if (!readHeader(r->file, &r->header)) {
+        fclose(r->file);
+        r->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// Returns 0 once the log is exhausted.
+int replayRead(ReplayReader *r, Input *in) {
+    if (r->runLeft == 0) {
+        int bits = fgetc(r->file);
+        uint32_t length;
+        if (bits == EOF || !readU16(r->file, &length) || length == 0)
+            return 0;
+        r->runBits = (uint8_t)bits;
+        r->runLeft = length;
+    }
+    r->runLeft--;
+    *in = unpackInput(r->runBits);
+    return 1;
+}
+
+void replayCloseRead(ReplayReader *r) {
+    if (r->file != NULL)
+        fclose(r->file);
+    r->file = NULL;
+}
@@ -0,0 +1,50 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "game.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define REPLAY_VERSION 2
+#define REPLAY_MAX_RUN 0xffff
+
+// Everything besides input that a run depends on. ticks and finalHash are
+// filled in when the recording is closed, so a replay can check that it ended
+// in the same state as the original session.
+typedef struct {
+    uint64_t seed;
+    int tickHz;
+    PoolConfig pools;
+    BroadphaseMode broadphase;
+    CollisionSolver solver;
+    int64_t ticks;
+    uint64_t finalHash;
+} ReplayHeader;
+
+// The log is the header followed by run-length encoded ticks: one byte of
+// input bits and a 16-bit repeat count per run. Held keys change rarely, so a
+// session costs a few bytes per second. All fields are little-endian.
+typedef struct {
+    FILE *file;
+    ReplayHeader header;
+    uint8_t runBits;
+    uint32_t runLength;
+} ReplayWriter;
+
+typedef struct {
+    FILE *file;
+    ReplayHeader header;
+    uint8_t runBits;
+    uint32_t runLeft;
+} ReplayReader;
+
+int replayOpenWrite(ReplayWriter *w, const char *path, ReplayHeader header);
+void replayWrite(ReplayWriter *w, Input in);
+int replayCloseWrite(ReplayWriter *w, uint64_t finalHash);
+
+int replayOpenRead(ReplayReader *r, const char *path);
+int replayRead(ReplayReader *r, Input *in);
+void replayCloseRead(ReplayReader *r);
+
+#endif
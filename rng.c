@@ -0,0 +1,26 @@
+#include "rng.h"
+
+#define PCG_MULTIPLIER 6364136223846793005ULL
+
+uint32_t rngNext(Rng *r) {
+    uint64_t old = r->state;
+    r->state = old * PCG_MULTIPLIER + r->inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+void rngSeed(Rng *r, uint64_t seed, uint64_t stream) {
+    r->state = 0;
+    r->inc = (stream << 1) | 1;
+    rngNext(r);
+    r->state += seed;
+    rngNext(r);
+}
+
+int rngRange(Rng *r, int min, int max) {
+    uint64_t span = (uint64_t)((int64_t)max - min + 1);
+    return min + (int)(((uint64_t)rngNext(r) * span) >> 32);
+}
+
+float rngFloat(Rng *r) { return (float)(rngNext(r) >> 8) * (1.0f / 16777216.0f); }
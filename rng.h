@@ -0,0 +1,23 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// PCG32 (O'Neill, XSH-RR variant). Each generator carries its own state and
+// stream selector, so generators seeded with the same seed but different
+// streams produce independent sequences and never share state.
+typedef struct {
+    uint64_t state;
+    uint64_t inc;
+} Rng;
+
+void rngSeed(Rng *r, uint64_t seed, uint64_t stream);
+uint32_t rngNext(Rng *r);
+
+// Uniform int in [min, max], using a multiply-shift instead of a modulo.
+int rngRange(Rng *r, int min, int max);
+
+// Uniform float in [0, 1).
+float rngFloat(Rng *r);
+
+#endif
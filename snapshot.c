@@ -0,0 +1,279 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char SNAPSHOT_MAGIC[4] = {'A', 'S', 'N', 'P'};
+
+static size_t asteroidBytes(int n) {
+    return (size_t)n * (10 * sizeof(float) + 3 * sizeof(int) + sizeof(AsteroidSize));
+}
+
+static size_t particleBytes(int n) {
+    return (size_t)n * (10 * sizeof(float) + sizeof(Color) + sizeof(uint8_t));
+}
+
+static size_t bulletBytes(int n) { return (size_t)n * (sizeof(Bullet) + 2 * sizeof(int)); }
+
+size_t snapshotSize(const World *w) {
+    return sizeof(SnapshotHeader) + asteroidBytes(w->asteroids.count) +
+           particleBytes(w->particles.count) + bulletBytes(w->bulletCapacity) +
+           sizeof(Star) * (size_t)w->starCount;
+}
+
+static void put(unsigned char **p, const void *src, size_t size) {
+    memcpy(*p, src, size);
+    *p += size;
+}
+
+static void take(const unsigned char **p, void *dst, size_t size) {
+    memcpy(dst, *p, size);
+    *p += size;
+}
+
+// Reads element i of an int array saved at p.
+static int savedInt(const unsigned char *p, int i) {
+    int v;
+    memcpy(&v, p + sizeof(int) * (size_t)i, sizeof(int));
+    return v;
+}
+
+// Checks the saved asteroids at p: sides index the polygon tables, size is a
+// known class, and hits is below maxHits, since applyEvents() splits an
+// asteroid the moment they become equal.
+static int validAsteroids(const unsigned char *p, int count) {
+    const unsigned char *sides = p + 10 * sizeof(float) * (size_t)count;
+    const unsigned char *hits = sides + sizeof(int) * (size_t)count;
+    const unsigned char *maxHits = hits + sizeof(int) * (size_t)count;
+    const unsigned char *size = maxHits + sizeof(int) * (size_t)count;
+    for (int i = 0; i < count; i++) {
+        AsteroidSize s;
+        memcpy(&s, size + sizeof(AsteroidSize) * (size_t)i, sizeof(s));
+        int n = savedInt(sides, i);
+        int hit = savedInt(hits, i);
+        if (n < ASTEROID_MIN_SIDES || n > ASTEROID_MAX_SIDES || s < AST_SMALL || s > AST_BIG ||
+            hit < 0 || hit >= savedInt(maxHits, i))
+            return 0;
+    }
+    return 1;
+}
+
+// Checks that every saved particle priority is a known one.
+static int validParticles(const unsigned char *p, int count) {
+    const unsigned char *priority = p + (10 * sizeof(float) + sizeof(Color)) * (size_t)count;
+    for (int i = 0; i < count; i++) {
+        if (priority[i] > PARTICLE_DEBRIS)
+            return 0;
+    }
+    return 1;
+}
+
+// Checks the saved bullet slots at p: every active flag is 0 or 1 and every
+// free-stack entry names an inactive slot below capacity.
+static int validBulletSlots(const unsigned char *p, int capacity, int freeCount) {
+    const unsigned char *active = p + sizeof(Bullet) * (size_t)capacity;
+    const unsigned char *freeSlots = active + sizeof(int) * (size_t)capacity;
+    for (int i = 0; i < capacity; i++) {
+        int a = savedInt(active, i);
+        if (a != 0 && a != 1)
+            return 0;
+    }
+    for (int i = 0; i < freeCount; i++) {
+        int slot = savedInt(freeSlots, i);
+        if (slot < 0 || slot >= capacity || savedInt(active, slot) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+// Returns the number of bytes written, or 0 if buf is too small.
+size_t saveSnapshot(const World *w, void *buf, size_t capacity) {
+    size_t total = snapshotSize(w);
+    if (capacity < total)
+        return 0;
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.headerSize = sizeof(SnapshotHeader);
+    h.totalSize = (uint32_t)total;
+    h.asteroidCount = w->asteroids.count;
+    h.particleCount = w->particles.count;
+    h.bulletCapacity = w->bulletCapacity;
+    h.bulletFreeCount = w->bulletFreeCount;
+    h.starCount = w->starCount;
+    h.game = w->game;
+    memcpy(h.rng, w->rng, sizeof(h.rng));
+    h.poolStats = w->poolStats;
+
+    unsigned char *p = buf;
+    put(&p, &h, sizeof(h));
+
+    const AsteroidStore *as = &w->asteroids;
+    size_t na = (size_t)as->count;
+    put(&p, as->posX, sizeof(float) * na);
+    put(&p, as->posY, sizeof(float) * na);
+    put(&p, as->velX, sizeof(float) * na);
+    put(&p, as->velY, sizeof(float) * na);
+    put(&p, as->prevX, sizeof(float) * na);
+    put(&p, as->prevY, sizeof(float) * na);
+    put(&p, as->radius, sizeof(float) * na);
+    put(&p, as->mass, sizeof(float) * na);
+    put(&p, as->rotation, sizeof(float) * na);
+    put(&p, as->prevRotation, sizeof(float) * na);
+    put(&p, as->sides, sizeof(int) * na);
+    put(&p, as->hits, sizeof(int) * na);
+    put(&p, as->maxHits, sizeof(int) * na);
+    put(&p, as->size, sizeof(AsteroidSize) * na);
+
+    const ParticleStore *ps = &w->particles;
+    size_t np = (size_t)ps->count;
+    put(&p, ps->posX, sizeof(float) * np);
+    put(&p, ps->posY, sizeof(float) * np);
+    put(&p, ps->velX, sizeof(float) * np);
+    put(&p, ps->velY, sizeof(float) * np);
+    put(&p, ps->prevX, sizeof(float) * np);
+    put(&p, ps->prevY, sizeof(float) * np);
+    put(&p, ps->lifetime, sizeof(float) * np);
+    put(&p, ps->invMaxLifetime, sizeof(float) * np);
+    put(&p, ps->fade, sizeof(float) * np);
+    put(&p, ps->size, sizeof(float) * np);
+    put(&p, ps->color, sizeof(Color) * np);
+    put(&p, ps->priority, sizeof(uint8_t) * np);
+
+    size_t nb = (size_t)w->bulletCapacity;
+    put(&p, w->bullets, sizeof(Bullet) * nb);
+    put(&p, w->bulletActive, sizeof(int) * nb);
+    put(&p, w->bulletFree, sizeof(int) * nb);
+
+    put(&p, w->stars, sizeof(Star) * (size_t)w->starCount);
+    return total;
+}
+
+// Pools grow to fit the snapshot when needed. Bullets are resized to the
+// saved capacity exactly, because slot order and the free stack decide which
+// slot the next shot takes. Returns 0 and leaves the world untouched if the
+// buffer is not a compatible snapshot.
+int restoreSnapshot(World *w, const void *buf, size_t size) {
+    SnapshotHeader h;
+    if (size < sizeof(h))
+        return 0;
+    memcpy(&h, buf, sizeof(h));
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0 || h.version != SNAPSHOT_VERSION ||
+        h.headerSize != sizeof(SnapshotHeader) || h.totalSize != size)
+        return 0;
+    if (h.asteroidCount < 0 || h.particleCount < 0 || h.bulletCapacity <= 0 || h.starCount < 0 ||
+        h.bulletFreeCount < 0 || h.bulletFreeCount > h.bulletCapacity)
+        return 0;
+    if (sizeof(h) + asteroidBytes(h.asteroidCount) + particleBytes(h.particleCount) +
+            bulletBytes(h.bulletCapacity) + sizeof(Star) * (size_t)h.starCount !=
+        size)
+        return 0;
+    const unsigned char *asteroidData = (const unsigned char *)buf + sizeof(h);
+    const unsigned char *particleData = asteroidData + asteroidBytes(h.asteroidCount);
+    const unsigned char *bulletData = particleData + particleBytes(h.particleCount);
+    if (!validAsteroids(asteroidData, h.asteroidCount) ||
+        !validParticles(particleData, h.particleCount) ||
+        !validBulletSlots(bulletData, h.bulletCapacity, h.bulletFreeCount))
+        return 0;
+
+    if (h.asteroidCount > w->asteroids.capacity)
+        reserveAsteroids(w, h.asteroidCount);
+    if (h.particleCount > w->particles.capacity)
+        reserveParticles(w, h.particleCount);
+    if (h.bulletCapacity != w->bulletCapacity) {
+        w->bulletCapacity = 0;
+        w->bulletFreeCount = 0;
+        reserveBullets(w, h.bulletCapacity);
+    }
+    if (h.starCount != w->starCount) {
+        w->stars = resizeArray(w->stars, h.starCount, sizeof(Star));
+        w->starCount = h.starCount;
+    }
+
+    w->game = h.game;
+    memcpy(w->rng, h.rng, sizeof(h.rng));
+    w->poolStats = h.poolStats;
+
+    const unsigned char *p = (const unsigned char *)buf + sizeof(h);
+
+    AsteroidStore *as = &w->asteroids;
+    size_t na = (size_t)h.asteroidCount;
+    as->count = h.asteroidCount;
+    take(&p, as->posX, sizeof(float) * na);
+    take(&p, as->posY, sizeof(float) * na);
+    take(&p, as->velX, sizeof(float) * na);
+    take(&p, as->velY, sizeof(float) * na);
+    take(&p, as->prevX, sizeof(float) * na);
+    take(&p, as->prevY, sizeof(float) * na);
+    take(&p, as->radius, sizeof(float) * na);
+    take(&p, as->mass, sizeof(float) * na);
+    take(&p, as->rotation, sizeof(float) * na);
+    take(&p, as->prevRotation, sizeof(float) * na);
+    take(&p, as->sides, sizeof(int) * na);
+    take(&p, as->hits, sizeof(int) * na);
+    take(&p, as->maxHits, sizeof(int) * na);
+    take(&p, as->size, sizeof(AsteroidSize) * na);
+
+    ParticleStore *ps = &w->particles;
+    size_t np = (size_t)h.particleCount;
+    ps->count = h.particleCount;
+    take(&p, ps->posX, sizeof(float) * np);
+    take(&p, ps->posY, sizeof(float) * np);
+    take(&p, ps->velX, sizeof(float) * np);
+    take(&p, ps->velY, sizeof(float) * np);
+    take(&p, ps->prevX, sizeof(float) * np);
+    take(&p, ps->prevY, sizeof(float) * np);
+    take(&p, ps->lifetime, sizeof(float) * np);
+    take(&p, ps->invMaxLifetime, sizeof(float) * np);
+    take(&p, ps->fade, sizeof(float) * np);
+    take(&p, ps->size, sizeof(float) * np);
+    take(&p, ps->color, sizeof(Color) * np);
+    take(&p, ps->priority, sizeof(uint8_t) * np);
+
+    size_t nb = (size_t)h.bulletCapacity;
+    take(&p, w->bullets, sizeof(Bullet) * nb);
+    take(&p, w->bulletActive, sizeof(int) * nb);
+    take(&p, w->bulletFree, sizeof(int) * nb);
+    w->bulletFreeCount = h.bulletFreeCount;
+
+    take(&p, w->stars, sizeof(Star) * (size_t)h.starCount);
+    w->grid.dirty = 1;
+    w->sap.stale = 1;
+    return 1;
+}
+
+int saveSnapshotFile(const World *w, const char *path) {
+    size_t size = snapshotSize(w);
+    void *buf = malloc(size);
+    if (buf == NULL)
+        return 0;
+    saveSnapshot(w, buf, size);
+
+    FILE *f = fopen(path, "wb");
+    int ok = f != NULL && fwrite(buf, 1, size, f) == size;
+    if (f != NULL)
+        ok &= fclose(f) == 0;
+    free(buf);
+    return ok;
+}
+
+int loadSnapshotFile(World *w, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return 0;
+
+    int ok = 0;
+    void *buf = NULL;
+    long size = 0;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        buf = malloc((size_t)size);
+        ok = buf != NULL && fread(buf, 1, (size_t)size, f) == (size_t)size &&
+             restoreSnapshot(w, buf, (size_t)size);
+    }
+    free(buf);
+    fclose(f);
+    return ok;
+}
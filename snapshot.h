@@ -0,0 +1,36 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "game.h"
+
+#include <stddef.h>
+
+#define SNAPSHOT_VERSION 2
+
+// A snapshot is one flat buffer: this header, then the live part of every
+// pool copied array by array. Values are stored in native layout, so saving
+// and restoring is a handful of memcpy calls; the version and the header size
+// reject snapshots taken by an incompatible build.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t totalSize;
+    int32_t asteroidCount;
+    int32_t particleCount;
+    int32_t bulletCapacity;
+    int32_t bulletFreeCount;
+    int32_t starCount;
+    Game game;
+    Rng rng[RNG_STREAM_COUNT];
+    PoolStats poolStats;
+} SnapshotHeader;
+
+size_t snapshotSize(const World *w);
+size_t saveSnapshot(const World *w, void *buf, size_t capacity);
+int restoreSnapshot(World *w, const void *buf, size_t size);
+
+int saveSnapshotFile(const World *w, const char *path);
+int loadSnapshotFile(World *w, const char *path);
+
+#endif